@@ -15,10 +15,17 @@
 #include <time.h>
 #include <math.h>
 #include "expr.h"
+#include "jit.h"
+#include "pool.h"
+#include "plot.h"
+#include "render.h"
+#include "font.h"
 #include "olcConsoleGameEngine.h"
 
 #define SCREEN_H 300
 #define SCREEN_W 300
+#define FRAME_RATE 60 //Frames per second at most
+#define MAX_FUNCS 256 //Functions plotted at most, the colors are shared
 
 using namespace std;
 
@@ -28,10 +35,28 @@ enum DEPTH
 	MAIN_MENU = 1,
 	ABOUT_WIN = 2,
 	FUNCS_WIN = 3,
-	FUNCEDITOR_WIN = 4
+	FUNCEDITOR_WIN = 4,
+	PARAMS_WIN = 5
 };
 
 /* UI STRUCTS */
+struct Rect //Screen area [x1, x2) * [y1, y2)
+{
+	int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+
+	Rect() { }
+	Rect(int x1, int y1, int x2, int y2) : x1(x1), y1(y1), x2(x2), y2(y2) { }
+
+	bool empty() const { return x1 >= x2 || y1 >= y2; }
+	bool overlaps(const Rect &rect) const { return !empty() && !rect.empty() && x1 < rect.x2 && rect.x1 < x2 && y1 < rect.y2 && rect.y1 < y2; }
+	bool contains(const Rect &rect) const { return rect.empty() || (x1 <= rect.x1 && y1 <= rect.y1 && rect.x2 <= x2 && rect.y2 <= y2); }
+	void add(const Rect &rect) //Grow to the bounding box of both
+	{
+		if (rect.empty()) return;
+		if (empty()) *this = rect;
+		else *this = Rect(min(x1, rect.x1), min(y1, rect.y1), max(x2, rect.x2), max(y2, rect.y2));
+	}
+};
 struct Menu
 {
 	bool visible = false,
@@ -42,6 +67,10 @@ struct Menu
 	int item_sel = 0;
 
 	int onClose_depth; //Depth set when window is closed
+
+	bool dirty = true; //To draw again
+	Rect drawn; //Area painted on the screen, empty if hidden
+	bool drawn_focus = false;
 };
 struct Button 
 {
@@ -50,12 +79,16 @@ struct Button
 	
 	string content;
 	function<void(void)> func;
+
+	bool dirty = true;
 };
 struct Label 
 {
 	int x, y;
 	
 	string content;
+
+	bool dirty = true;
 };
 struct TextBox
 {
@@ -64,6 +97,12 @@ struct TextBox
 
 	string content;
 	int cursor_pos = -1;
+
+	bool dirty = true;
+	Rect drawn; //Box and cursor painted by the last draw, the cursor can pass the box
+
+	vector<int> advance_sum = { 0 }; //Pixels taken by the first i chars
+	vector<int> part_pos = { 0 }; //First char of every partition shown while scrolling
 };
 struct ListBox
 {
@@ -74,7 +113,22 @@ struct ListBox
 	vector<string> headers;
 	vector<function<void(void)>> funcs;
 
-	int item_sel = 0;
+	int item_sel = 0,
+		first_row = 0; //First item shown, scrolled to keep item_sel in view
+
+	bool dirty = true;
+};
+struct Slider
+{
+	bool focus = false;
+	int x, y, width;
+
+	double value = 1,
+		min = -10, max = 10,
+		step = 0.05; //Change per frame while an arrow is held, ten times with shift
+	function<void(void)> func; //Ran when value changes
+
+	bool dirty = true;
 };
 struct Window
 {
@@ -88,19 +142,16 @@ struct Window
 	vector<Label> labels;
 	vector<ListBox> listboxes;
 	vector<TextBox> textboxes;
+	vector<Slider> sliders;
 
 	function<void(void)> onEscape = []{}; //Function ran when esc key pressed
 
 	int onClose_depth,
 		child_focus = 0; //Element inside window focused
-};
 
-/* GRAPHIC CALC STRUCTS */
-struct Function
-{
-	string function;
-	vector<string> postfix_code;
-	COLOUR color;
+	bool dirty = true; //Border, title and every child to draw again
+	Rect drawn; //Area painted on the screen, empty if hidden
+	bool drawn_focus = false;
 };
 
 /* ENVIRONMENT CLASS */
@@ -110,6 +161,7 @@ public:
 	Environment() 
 	{
 		m_sAppName = L"Graphics Calculator";
+		SetFramePacing(FRAME_RATE, true); //Everything moves on input, idle frames can wait for it
 	}
 
 private:
@@ -119,22 +171,30 @@ private:
 	//UI OBJECTS
 	vector<Function> graph_funcs;
 	Menu main_menu;
-	Window about_win, funcs_win, funceditor_win, error_win;
+	Window about_win, funcs_win, funceditor_win, params_win, error_win;
 
 	bool error_win_drawn = false;
 
 	//Function position to be changed
 	int funceditor_funcpos;
 	
-	//All colors
-	map<string, COLOUR> color_code;
-	map<COLOUR, string> color_name;
-	map<string, bool> is_color_av;
-
 	//GRAPH VARS
 	double zoom, min_zoom, max_zoom, zoom_k,
 		calc_approx;
 	int offset_x, offset_y;
+	bool use_jit = true; //Evaluate with native code when available
+	WorkerPool pool; //Samples the functions in parallel
+	int evals = 0; //Evaluations made by the last renderPlan
+	Canvas plot_canvas; //Plot of the last renderPlan, without the overlay
+
+	//PLOT LAYER
+	vector<CHAR_INFO> plot_layer; //Last rendered plot, drawn again while the view and the functions stay the same
+	double layer_zoom = 0;
+	int layer_offset_x = 0, layer_offset_y = 0;
+	bool plot_dirty = true; //graph_funcs changed since the layer was rendered
+
+	//UI LAYERS
+	Rect ui_damage; //Screen area drawn this frame, the windows above it must be drawn again
 
 	//DEPTH
 	int depth; //Position in menus/windows
@@ -149,8 +209,9 @@ private:
 			//Set visibility
 			main_menu.visible = depth >= MAIN_MENU;
 			about_win.visible = depth == ABOUT_WIN;
-			funcs_win.visible = depth >= FUNCS_WIN;
+			funcs_win.visible = depth == FUNCS_WIN || depth == FUNCEDITOR_WIN;
 			funceditor_win.visible = depth == FUNCEDITOR_WIN;
+			params_win.visible = depth == PARAMS_WIN;
 			if (error_win.visible)
 			{
 				if (error_win_drawn) error_win.visible = error_win_drawn = false;
@@ -162,594 +223,26 @@ private:
 			about_win.focus = depth == ABOUT_WIN && !error_win.visible;
 			funcs_win.focus = depth == FUNCS_WIN && !error_win.visible;
 			funceditor_win.focus = depth == FUNCEDITOR_WIN && !error_win.visible;
+			params_win.focus = depth == PARAMS_WIN && !error_win.visible;
 		}
 	}
 
 	//STRINGS FUNCS
-	vector<vector<bool>> str_getCharFillers(char ch)
-	{
-		switch (ch) {
-		case 'A': case 'a':
-			return
-			{
-				{ 0, 1, 1, 0, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-			};
-			break;
-		case 'B': case 'b':
-			return
-			{
-				{ 1, 1, 1, 0, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 0, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 0, 0 },
-			};
-			break;
-		case 'C': case 'c':
-			return
-			{
-				{ 0, 1, 1, 1, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 1, 1, 1, 0 },
-			};
-			break;
-		case 'D': case 'd':
-			return
-			{
-				{ 1, 1, 1, 0, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 0, 0 },
-			};
-			break;
-		case 'E': case 'e':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 1, 1, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 1, 1, 1, 0 },
-			};
-			break;
-		case 'F': case 'f':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 1, 1, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-			};
-			break;
-		case 'G': case 'g':
-			return
-			{
-				{ 0, 1, 1, 1, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 1, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 0, 1, 1, 1, 0 },
-			};
-			break;
-		case 'H': case 'h':
-			return
-			{
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-			};
-			break;
-		case 'I': case 'i':
-			return
-			{
-				{ 1, 1, 1, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 1, 1, 1, 0, 0 },
-			};
-			break;
-		case 'J': case 'j':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 0, 0, 1, 0, 0 },
-				{ 0, 0, 1, 0, 0 },
-				{ 1, 0, 1, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-			};
-			break;
-		case 'K': case 'k':
-			return
-			{
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 1, 0, 0 },
-				{ 1, 1, 0, 0, 0 },
-				{ 1, 0, 1, 0, 0 },
-				{ 1, 0, 0, 1, 0 },
-			};
-			break;
-		case 'L': case 'l':
-			return
-			{
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 1, 1, 1, 0 },
-			};
-			break;
-		case 'M': case 'm':
-			return
-			{
-				{ 1, 0, 0, 0, 1 },
-				{ 1, 1, 0, 1, 1 },
-				{ 1, 0, 1, 0, 1 },
-				{ 1, 0, 0, 0, 1 },
-				{ 1, 0, 0, 0, 1 },
-			};
-			break;
-		case 'N': case 'n':
-			return
-			{
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 0, 1, 0 },
-				{ 1, 0, 1, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-			};
-			break;
-		case 'O': case 'o':
-			return
-			{
-				{ 0, 1, 1, 0, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 0, 1, 1, 0, 0 },
-			};
-			break;
-		case 'P': case 'p':
-			return
-			{
-				{ 1, 1, 1, 0, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-			};
-			break;
-		case 'Q': case 'q':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 1, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-			};
-			break;
-		case 'R': case 'r':
-			return
-			{
-				{ 1, 1, 1, 0, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 0, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-			};
-			break;
-		case 'S': case 's':
-			return
-			{
-				{ 0, 1, 1, 1, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 1, 1, 0, 0 },
-				{ 0, 0, 0, 1, 0 },
-				{ 1, 1, 1, 0, 0 },
-			};
-			break;
-		case 'T': case 't':
-			return
-			{
-				{ 1, 1, 1, 1, 1 },
-				{ 0, 0, 1, 0, 0 },
-				{ 0, 0, 1, 0, 0 },
-				{ 0, 0, 1, 0, 0 },
-				{ 0, 0, 1, 0, 0 },
-			};
-			break;
-		case 'U': case 'u':
-			return
-			{
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 0, 1, 1, 0, 0 },
-			};
-			break;
-		case 'V': case 'v':
-			return
-			{
-				{ 1, 0, 0, 0, 1 },
-				{ 1, 0, 0, 0, 1 },
-				{ 1, 0, 0, 0, 1 },
-				{ 0, 1, 0, 1, 0 },
-				{ 0, 0, 1, 0, 0 },
-			};
-			break;
-		case 'W': case 'w':
-			return
-			{
-				{ 1, 0, 0, 0, 1 },
-				{ 1, 0, 0, 0, 1 },
-				{ 1, 0, 0, 0, 1 },
-				{ 1, 0, 1, 0, 1 },
-				{ 0, 1, 0, 1, 0 },
-			};
-			break;
-		case 'X': case 'x':
-			return
-			{
-				{ 1, 0, 0, 0, 1 },
-				{ 0, 1, 0, 1, 0 },
-				{ 0, 0, 1, 0, 0 },
-				{ 0, 1, 0, 1, 0 },
-				{ 1, 0, 0, 0, 1 },
-			};
-			break;
-		case 'Y': case 'y':
-			return
-			{
-				{ 1, 0, 0, 0, 1 },
-				{ 0, 1, 0, 1, 0 },
-				{ 0, 0, 1, 0, 0 },
-				{ 0, 0, 1, 0, 0 },
-				{ 0, 0, 1, 0, 0 },
-			};
-			break;
-		case 'Z': case 'z':
-			return
-			{
-				{ 1, 1, 1, 1, 1 },
-				{ 0, 0, 0, 1, 0 },
-				{ 0, 0, 1, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 1, 1, 1, 1, 1 },
-			};
-			break;
-		case '0':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-			};
-			break;
-		case '1':
-			return
-			{
-				{ 1, 1, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-			};
-			break;
-		case '2':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 1, 1, 1, 0 },
-			};
-			break;
-		case '3':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-				{ 0, 1, 1, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-			};
-			break;
-		case '4':
-			return
-			{
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-			};
-			break;
-		case '5':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 1, 1, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-			};
-			break;
-		case '6':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-			};
-			break;
-		case '7':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-			};
-			break;
-		case '8':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-			};
-			break;
-		case '9':
-			return
-			{
-				{ 1, 1, 1, 1, 0 },
-				{ 1, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-				{ 0, 0, 0, 1, 0 },
-				{ 1, 1, 1, 1, 0 },
-			};
-			break;
-		case '!':
-			return
-			{
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-			};
-			break;
-		case '?':
-			return
-			{
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-			};
-			break;
-		case '.':
-			return
-			{
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-			};
-			break;
-		case ':':
-			return
-			{
-				{ 0, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-			};
-			break;
-		case ';':
-			return
-			{
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-			};
-			break;
-		case '+':
-			return
-			{
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 1, 1, 1, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-			};
-			break;
-		case '-':
-			return
-			{
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 1, 1, 1, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-			};
-			break;
-		case '*':
-			return
-			{
-				{ 1, 0, 1, 0 },
-				{ 0, 1, 0, 0 },
-				{ 1, 0, 1, 0 },
-				{ 0, 0, 0, 0 },
-				{ 0, 0, 0, 0 },
-			};
-			break;
-		case '/':
-			return
-			{
-				{ 0, 0, 1, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-			};
-			break;
-		case '^':
-			return
-			{
-				{ 0, 1, 0, 0 },
-				{ 1, 0, 1, 0 },
-				{ 0, 0, 0, 0 },
-				{ 0, 0, 0, 0 },
-				{ 0, 0, 0, 0 },
-			};
-			break;
-		case '(':
-			return
-			{
-				{ 0, 1, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-			};
-			break;
-		case ')':
-			return
-			{
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 0, 1, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-			};
-			break;
-		case '=':
-			return
-			{
-				{ 0, 0, 0, 0, 0 },
-				{ 1, 1, 1, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 1, 1, 1, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-			};
-			break;
-		case '\'':
-			return
-			{
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-			};
-			break;
-		case '_':
-			return
-			{
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 1, 1, 1, 1, 1 },
-			};
-			break;
-		case ' ':
-			return
-			{
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-				{ 0, 0, 0, 0, 0 },
-			};
-			break;
-		case '|':
-			return
-			{
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-				{ 1, 0, 0, 0, 0 },
-			};
-			break;
-		default:
-			throw invalid_argument("Char unsupported!");
-		}
-	}
-	int str_getCharWidth(vector<vector<bool>> fillers)
-	{
-		bool width_got = false; //Got the width
-		int w;
-		for (w = 0; w < 5 && !width_got; w++)
-		{
-			width_got = true;
-			for (int h = 0; h < 5; h++) width_got = !fillers[h][w] && width_got;
-			if (width_got) w--;
-		}
-		//Space control
-		if (w == 0) w++;
-
-		return w;
-	}
-	int str_length(string content)
+	int str_length(const string &content) { return fontLength(content); }
+	void str_draw(int x, int y, const string &content, COLOUR color, int max_width = 0, int first = 0) //Draw content from the char first
 	{
 		int filled_px = 0;
-
-		for (int i = 0; i < content.length(); i++)
-		{
-			//Get char
-			vector<vector<bool>> fillers = str_getCharFillers(content[i]);
-
-			//Get width
-			int width = str_getCharWidth(fillers);
-
-			filled_px += width + 1; //Add space
-		}
-
-		return filled_px;
-	}
-	void str_draw(int x, int y, string content, COLOUR color, int max_width = 0)
-	{
-		int filled_px = 0;
-		for (int i = 0; i < content.length() && (max_width == 0 || filled_px < max_width); i++)
+		for (int i = first; i < content.length() && (max_width == 0 || filled_px < max_width); i++)
 		{
-			vector<vector<bool>> fillers = str_getCharFillers(content[i]);
-			int width = str_getCharWidth(fillers);
+			const Glyph &glyph = fontGlyph(content[i]);
 
 			//Draw
-			for (int _y = 0; _y < 5; _y++)
-				for (int _x = 0; _x < width; _x++)
-					if (fillers[_y][_x] && (max_width == 0 || (_x + filled_px) < max_width)) 
+			for (int _y = 0; _y < FONT_SIZE; _y++)
+				for (int _x = 0; _x < glyph.width; _x++)
+					if (glyph.pixel(_x, _y) && (max_width == 0 || (_x + filled_px) < max_width))
 						Draw(_x + x + filled_px, _y + y, L' ', color);
 
-			filled_px += width + 1; //Add space
+			filled_px += glyph.width + 1; //Add space
 		}
 	}
 
@@ -760,6 +253,7 @@ private:
 		if (depth == ABOUT_WIN) ui_drawWindow(about_win);
 		if (depth == FUNCS_WIN) ui_drawWindow(funcs_win);
 		if (depth == FUNCEDITOR_WIN) ui_drawWindow(funceditor_win);
+		if (depth == PARAMS_WIN) ui_drawWindow(params_win);
 		ui_drawWindow(error_win);
 	}
 	//UI UPDATES
@@ -767,13 +261,22 @@ private:
 	{
 		if (menu.focus) 
 		{
-			if (m_keys[VK_RIGHT].bPressed && menu.item_sel < menu.headers.size() - 1) menu.item_sel++;
-			if (m_keys[VK_LEFT].bPressed && menu.item_sel > 0) menu.item_sel--;
+			if (m_keys[VK_RIGHT].bPressed && menu.item_sel < menu.headers.size() - 1)
+			{
+				menu.item_sel++;
+				menu.dirty = true;
+			}
+			if (m_keys[VK_LEFT].bPressed && menu.item_sel > 0)
+			{
+				menu.item_sel--;
+				menu.dirty = true;
+			}
 			if (m_keys[VK_SPACE].bPressed) menu.funcs[menu.item_sel]();
 			if (m_keys[VK_ESCAPE].bPressed)
 			{
 				changeDepth(menu.onClose_depth);
 				menu.item_sel = 0;
+				menu.dirty = true;
 			}
 		}
 	}
@@ -781,12 +284,53 @@ private:
 	{
 		if (m_keys[VK_SPACE].bPressed && button.focus) button.func();
 	}
+	void ui_partitionTextBox(TextBox &textbox) //Split the text in partitions as large as the textbox
+	{
+		int prec_length = 0; //Last partition length
+		textbox.part_pos.assign(1, 0);
+		for (int pos = 0; pos < textbox.content.length(); pos++)
+		{
+			if ((textbox.advance_sum[pos + 1] - prec_length) > (textbox.width - 2))
+			{
+				textbox.part_pos.push_back(pos);
+				prec_length = textbox.advance_sum[pos];
+			}
+		}
+	}
+	void ui_setTextBoxContent(TextBox &textbox, const string &content)
+	{
+		textbox.content = content;
+		textbox.cursor_pos = -1;
+		textbox.dirty = true;
+		textbox.advance_sum.assign(1, 0);
+		for (char c : content) textbox.advance_sum.push_back(textbox.advance_sum.back() + fontGlyph(c).width + 1);
+		ui_partitionTextBox(textbox);
+	}
 	void ui_addTextBoxChar(TextBox &textbox, char c)
 	{
 		if (textbox.content.length() < 256)
 		{
+			int advance = fontGlyph(c).width + 1;
+
 			textbox.cursor_pos++;
-			textbox.content.insert(textbox.cursor_pos, string(1, c));
+			textbox.content.insert(textbox.cursor_pos, 1, c);
+			textbox.advance_sum.insert(textbox.advance_sum.begin() + textbox.cursor_pos + 1, textbox.advance_sum[textbox.cursor_pos]);
+			for (int i = textbox.cursor_pos + 1; i < textbox.advance_sum.size(); i++) textbox.advance_sum[i] += advance;
+			ui_partitionTextBox(textbox);
+			textbox.dirty = true;
+		}
+	}
+	void ui_removeTextBoxChar(TextBox &textbox, int pos)
+	{
+		if (pos < textbox.content.length())
+		{
+			int advance = textbox.advance_sum[pos + 1] - textbox.advance_sum[pos];
+
+			textbox.content.erase(pos, 1);
+			textbox.advance_sum.erase(textbox.advance_sum.begin() + pos + 1);
+			for (int i = pos + 1; i < textbox.advance_sum.size(); i++) textbox.advance_sum[i] -= advance;
+			ui_partitionTextBox(textbox);
+			textbox.dirty = true;
 		}
 	}
 	void ui_updateTextBox(TextBox &textbox)
@@ -826,9 +370,12 @@ private:
 				//Plus
 				if (m_keys[VK_OEM_PLUS].bPressed) 
 					ui_addTextBoxChar(textbox, '+');
-				//Comma
-				if (m_keys[VK_OEM_COMMA].bPressed || m_keys[VK_OEM_PERIOD].bPressed) 
+				//Point
+				if (m_keys[VK_OEM_PERIOD].bPressed) 
 					ui_addTextBoxChar(textbox, '.');
+				//Comma
+				if (m_keys[VK_OEM_COMMA].bPressed) 
+					ui_addTextBoxChar(textbox, ',');
 				//Minus
 				if (m_keys[VK_OEM_MINUS].bPressed) 
 					ui_addTextBoxChar(textbox, '-');
@@ -840,14 +387,22 @@ private:
 					ui_addTextBoxChar(textbox, i - 0x40 + 'a' - 1);
 #pragma endregion
 #pragma region move
-			if (m_keys[VK_LEFT].bPressed && textbox.cursor_pos > -1) textbox.cursor_pos--;
-			if (m_keys[VK_RIGHT].bPressed && (textbox.cursor_pos + 1) < textbox.content.length()) textbox.cursor_pos++;
+			if (m_keys[VK_LEFT].bPressed && textbox.cursor_pos > -1)
+			{
+				textbox.cursor_pos--;
+				textbox.dirty = true;
+			}
+			if (m_keys[VK_RIGHT].bPressed && (textbox.cursor_pos + 1) < textbox.content.length())
+			{
+				textbox.cursor_pos++;
+				textbox.dirty = true;
+			}
 #pragma endregion
 #pragma region remove
 			if ((m_keys[VK_BACK].bPressed && textbox.cursor_pos > -1) || m_keys[VK_DELETE].bPressed)
 			{
 				if (m_keys[VK_BACK].bPressed) textbox.cursor_pos--;
-				textbox.content.erase(textbox.cursor_pos + 1, 1);
+				ui_removeTextBoxChar(textbox, textbox.cursor_pos + 1);
 			}
 #pragma endregion
 		}
@@ -856,23 +411,68 @@ private:
 	{
 		if (listbox.focus && listbox.headers.size() > 0)
 		{
-			if (m_keys[VK_UP].bPressed && listbox.item_sel > 0) listbox.item_sel--;
-			if (m_keys[VK_DOWN].bPressed && listbox.item_sel < listbox.headers.size() - 1) listbox.item_sel++;
+			if (m_keys[VK_UP].bPressed && listbox.item_sel > 0)
+			{
+				listbox.item_sel--;
+				listbox.dirty = true;
+			}
+			if (m_keys[VK_DOWN].bPressed && listbox.item_sel < listbox.headers.size() - 1)
+			{
+				listbox.item_sel++;
+				listbox.dirty = true;
+			}
+			//Page
+			if (m_keys[VK_LEFT].bPressed && listbox.item_sel > 0)
+			{
+				listbox.item_sel = max(listbox.item_sel - listbox.rows, 0);
+				listbox.dirty = true;
+			}
+			if (m_keys[VK_RIGHT].bPressed && listbox.item_sel < listbox.headers.size() - 1)
+			{
+				listbox.item_sel = min(listbox.item_sel + listbox.rows, (int)listbox.headers.size() - 1);
+				listbox.dirty = true;
+			}
 			if (m_keys[VK_SPACE].bPressed) listbox.funcs[listbox.item_sel]();
 		}
 	}
+	void ui_updateSlider(Slider &slider)
+	{
+		if (slider.focus && (m_keys[VK_LEFT].bHeld ^ m_keys[VK_RIGHT].bHeld))
+		{
+			//Moves every frame while held
+			double step = slider.step * (m_keys[VK_SHIFT].bHeld ? 10 : 1),
+				value = slider.value + (m_keys[VK_RIGHT].bHeld ? step : -step);
+			value = max(slider.min, min(slider.max, round(value / slider.step) * slider.step));
+
+			if (value != slider.value)
+			{
+				slider.value = value;
+				slider.dirty = true;
+				slider.func();
+			}
+		}
+	}
 	void ui_changeWindowChild(Window &win, int target)
 	{
 		//Update child_focus state
 		win.child_focus = target;
 
-		//Update focus states
-		for (int i = 0; i < (win.buttons.size() + win.listboxes.size() + win.textboxes.size()); i++)
+		//Update focus states, the children that change are drawn again
+		auto setFocus = [](auto &child, bool focus_state)
+		{
+			if (child.focus != focus_state)
+			{
+				child.focus = focus_state;
+				child.dirty = true;
+			}
+		};
+		for (int i = 0; i < (win.buttons.size() + win.listboxes.size() + win.textboxes.size() + win.sliders.size()); i++)
 		{
 			bool focus_state = i == win.child_focus;
-			if (i < win.buttons.size()) win.buttons[i].focus = focus_state;
-			else if ((i - win.buttons.size()) < win.textboxes.size()) win.textboxes[i - win.buttons.size()].focus = focus_state;
-			else win.listboxes[i - win.buttons.size() - win.textboxes.size()].focus = focus_state;
+			if (i < win.buttons.size()) setFocus(win.buttons[i], focus_state);
+			else if ((i - win.buttons.size()) < win.textboxes.size()) setFocus(win.textboxes[i - win.buttons.size()], focus_state);
+			else if ((i - win.buttons.size() - win.textboxes.size()) < win.listboxes.size()) setFocus(win.listboxes[i - win.buttons.size() - win.textboxes.size()], focus_state);
+			else setFocus(win.sliders[i - win.buttons.size() - win.textboxes.size() - win.listboxes.size()], focus_state);
 		}
 	}
 	void ui_updateWin(Window &win)
@@ -886,7 +486,7 @@ private:
 			}
 			if (m_keys[VK_TAB].bPressed || win.child_focus == -1)
 			{
-				if (win.child_focus == (win.buttons.size() + win.listboxes.size() + win.textboxes.size() - 1))
+				if (win.child_focus == (win.buttons.size() + win.listboxes.size() + win.textboxes.size() + win.sliders.size() - 1))
 					ui_changeWindowChild(win, 0);
 				else
 					ui_changeWindowChild(win, win.child_focus + 1);
@@ -901,6 +501,12 @@ private:
 		{
 			//Update
 			if (!changing_depth) ui_updateMenu(menu);
+			if (!menu.visible) return; //Closed, the depth change draws what was below
+
+			//Draw again only if changed or covered
+			Rect rect(cont_x, cont_y, cont_x + cont_width, cont_y + 7);
+			if (menu.drawn.empty() || menu.drawn_focus != menu.focus || ui_damage.overlaps(rect)) menu.dirty = true;
+			if (!menu.dirty) return;
 
 			//Draw
 			Fill(cont_x, cont_y, cont_x + cont_width, cont_y + 7, L' ', BG_DARK_GREY);
@@ -915,32 +521,41 @@ private:
 
 				total_length += length + 2;
 			}
+
+			menu.dirty = false;
+			menu.drawn = rect;
+			menu.drawn_focus = menu.focus;
+			ui_damage.add(rect);
 		}
 	}
-	void ui_drawButton(Button &button, int cont_x, int cont_y)
+	Rect ui_drawButton(Button &button, int cont_x, int cont_y) //Returns the area painted
 	{
-		//Update
-		if (!changing_depth) ui_updateButton(button);
-
 		int x = cont_x + button.x,
 			y = cont_y + button.y;
+		Rect rect(x, y, x + str_length(button.content) + 3, y + 7);
 
-		Fill(x, y, x + str_length(button.content) + 3, y + 7, L' ', button.focus ? BG_BLACK : BG_GREY);
+		Fill(rect.x1, rect.y1, rect.x2, rect.y2, L' ', button.focus ? BG_BLACK : BG_GREY);
 		str_draw(x + 2, y + 1, button.content, BG_WHITE);
+
+		return rect;
 	}
-	void ui_drawLabel(Label &label, int cont_x, int cont_y, COLOUR color)
+	Rect ui_drawLabel(Label &label, int cont_x, int cont_y, COLOUR color)
 	{
 		str_draw(cont_x + label.x, cont_y + label.y, label.content, color);
+
+		return Rect(cont_x + label.x, cont_y + label.y, cont_x + label.x + str_length(label.content), cont_y + label.y + FONT_SIZE);
 	}
-	void ui_drawTextBox(TextBox &textbox, int cont_x, int cont_y)
+	Rect ui_textBoxRect(TextBox &textbox, int cont_x, int cont_y)
+	{
+		return Rect(textbox.x + cont_x, textbox.y + cont_y, textbox.x + cont_x + textbox.width, textbox.y + cont_y + 9);
+	}
+	Rect ui_drawTextBox(TextBox &textbox, int cont_x, int cont_y)
 	{
-		//Update
-		if (!changing_depth) ui_updateTextBox(textbox);
-
 		const int min_distance_txt = 2; //Minimum distance in pixel from right before shifting the text
 
 		int x = textbox.x + cont_x,
 			y = textbox.y + cont_y;
+		Rect rect = ui_textBoxRect(textbox, cont_x, cont_y);
 
 		Fill(x, y, x + textbox.width, y + 9, L' ', textbox.focus ? BG_DARK_GREY : BG_GREY);
 
@@ -957,34 +572,26 @@ private:
 			content = textbox.content.substr(0, distance - ((distance == textbox.content.length()) ? 0 : 1)); //Remove another character if the string was too large and make the string
 		}*/
 
-		//Map string
-		vector<int> part_pos = { 0 }; //Partition position array
-		int tot_length = 0; //Total length
-		int prec_length = 0; //Last partition length
-		for (int pos = 0; pos < textbox.content.length(); pos++) //Text division in partions
-		{
-			tot_length += str_length(string(1, textbox.content.at(pos)));
-			if ((tot_length - prec_length) > (textbox.width - 2))
-			{
-				part_pos.push_back(pos);
-				prec_length = tot_length - str_length(string(1, textbox.content.at(pos)));
-			}
-		}
+		//Obtain partition number and its first char, the partitions are kept by the edits
+		const vector<int> &advance_sum = textbox.advance_sum;
+		int length = textbox.content.length(),
+			part_n = min((int)(advance_sum[min(textbox.cursor_pos + 2, length)] / (textbox.width - 2)), (int)textbox.part_pos.size() - 1),
+			part_begin = textbox.part_pos[part_n];
 
-		//Obtain partition number and string
-		int part_n = (int)(str_length(textbox.content.substr(0, textbox.cursor_pos + 2)) / (textbox.width - 2));
-		string content = textbox.content.substr(part_pos[part_n], textbox.content.length() - part_pos[part_n]);
+		str_draw(x + 1, y + 2, textbox.content, textbox.focus ? BG_BLACK : BG_DARK_GREY, textbox.width - 2, part_begin);
 
-		str_draw(x + 1, y + 2, content, textbox.focus ? BG_BLACK : BG_DARK_GREY, textbox.width - 2);
+		if (textbox.focus)
+		{
+			int cursor_end = (textbox.cursor_pos + 1 < part_begin) ? length : min(textbox.cursor_pos + 1, length), //Before the partition the whole text is skipped
+				cursor_x = x + 1 + advance_sum[cursor_end] - advance_sum[part_begin];
+			str_draw(cursor_x, y + 2, "|", BG_WHITE, textbox.width - 2);
+			rect.add(Rect(cursor_x, y + 2, cursor_x + 1, y + 2 + FONT_SIZE));
+		}
 
-		if(textbox.focus) 
-			str_draw(x + 1 + str_length(content.substr(0, textbox.cursor_pos - part_pos[part_n] + 1)), y + 2, "|", BG_WHITE, textbox.width - 2);
+		return rect;
 	}
-	void ui_drawListBox(ListBox &listbox, int cont_x, int cont_y)
+	Rect ui_drawListBox(ListBox &listbox, int cont_x, int cont_y)
 	{
-		//Update
-		if (!changing_depth) ui_updateListBox(listbox);
-
 		int x = cont_x + listbox.x,
 			y = cont_y + listbox.y;
 
@@ -992,95 +599,229 @@ private:
 		Fill(x - 1, y - 1, x + listbox.width + 1, y + listbox.rows * 10, L' ', (listbox.focus) ? BG_DARK_GREY : BG_GREY);
 		Fill(x, y, x + listbox.width, y + listbox.rows * 10 - 1, L' ', BG_WHITE);
 
-		//Draw content
-		if (listbox.headers.size() == 0) 
+		//Scroll to the selected item
+		int count = listbox.headers.size();
+		if (listbox.item_sel < listbox.first_row) listbox.first_row = listbox.item_sel;
+		if (listbox.item_sel >= listbox.first_row + listbox.rows) listbox.first_row = listbox.item_sel - listbox.rows + 1;
+		listbox.first_row = max(0, min(listbox.first_row, count - listbox.rows));
+
+		//Draw content, only the rows shown
+		if (count == 0) 
 			str_draw(x + (listbox.width - str_length("EMPTY")) / 2, y + 2, "EMPTY", BG_GREY);
 		else
 		{
-			for (int i = 0; i < listbox.rows && i < listbox.headers.size(); i++)
+			for (int row = 0; row < listbox.rows && listbox.first_row + row < count; row++)
 			{
+				int i = listbox.first_row + row;
+
 				if (listbox.item_sel == i)
-					Fill(x, y + i * 10, x + listbox.width, y + i * 10 + 9, L' ', listbox.focus ? BG_BLACK : BG_GREY);
-				DrawLine(x, y + i * 10 + 9, x + listbox.width - 1, y + i * 10 + 9, L' ', listbox.focus ? BG_DARK_GREY : BG_GREY);
+					Fill(x, y + row * 10, x + listbox.width, y + row * 10 + 9, L' ', listbox.focus ? BG_BLACK : BG_GREY);
+				DrawLine(x, y + row * 10 + 9, x + listbox.width - 1, y + row * 10 + 9, L' ', listbox.focus ? BG_DARK_GREY : BG_GREY);
 				if((listbox.width - 4) > str_length(listbox.headers[i]))
-					str_draw(x + (listbox.width - str_length(listbox.headers[i])) / 2, y + i * 10 + 2, listbox.headers[i], (listbox.item_sel == i) ? BG_WHITE : listbox.focus ? BG_DARK_GREY : BG_GREY);
+					str_draw(x + (listbox.width - str_length(listbox.headers[i])) / 2, y + row * 10 + 2, listbox.headers[i], (listbox.item_sel == i) ? BG_WHITE : listbox.focus ? BG_DARK_GREY : BG_GREY);
 				else
-					str_draw(x + 2, y + i * 10 + 2, listbox.headers[i], (listbox.item_sel == i) ? BG_WHITE : listbox.focus ? BG_DARK_GREY : BG_GREY, listbox.width - 4);
+					str_draw(x + 2, y + row * 10 + 2, listbox.headers[i], (listbox.item_sel == i) ? BG_WHITE : listbox.focus ? BG_DARK_GREY : BG_GREY, listbox.width - 4);
+			}
+
+			//Draw scroll bar if not everything fits
+			if (count > listbox.rows)
+			{
+				int height = listbox.rows * 10 - 1,
+					bar_y = height * listbox.first_row / count,
+					bar_h = max(2, height * listbox.rows / count);
+				Fill(x + listbox.width - 1, y + bar_y, x + listbox.width, y + min(bar_y + bar_h, height), L' ', listbox.focus ? BG_DARK_GREY : BG_GREY);
 			}
 		}
+
+		return Rect(x - 1, y - 1, x + listbox.width + 1, y + listbox.rows * 10);
+	}
+	Rect ui_drawSlider(Slider &slider, int cont_x, int cont_y)
+	{
+		int x = cont_x + slider.x,
+			y = cont_y + slider.y,
+			track = slider.width - 32; //The value is written on the right
+		Rect rect(x, y, x + slider.width, y + 7);
+		COLOUR color = slider.focus ? BG_BLACK : BG_GREY;
+
+		Fill(rect.x1, rect.y1, rect.x2, rect.y2, L' ', BG_WHITE);
+
+		//Draw track and knob
+		int knob = x + 1 + (int)round((slider.value - slider.min) / (slider.max - slider.min) * (track - 3));
+		DrawLine(x, y + 3, x + track - 1, y + 3, L' ', slider.focus ? BG_DARK_GREY : BG_GREY);
+		Fill(knob - 1, y, knob + 2, y + 7, L' ', color);
+
+		//Draw value
+		char value[16];
+		snprintf(value, sizeof(value), "%.2f", slider.value);
+		str_draw(x + track + 3, y + 1, value, color);
+
+		return rect;
 	}
 	void ui_drawWindow(Window &win)
 	{
 		if (win.visible)
 		{
-			//Update
-			if(!changing_depth) ui_updateWin(win);
+			int x = win.x,
+				y = win.y + 8;
 
-			//Draw border
-			Fill(win.x - 1, win.y - 1, win.x + win.width + 1, win.y + win.height + 1, L' ', (win.focus) ? BG_BLACK : BG_DARK_GREY);
+			//Update, the children drawn below come from here
+			if (!changing_depth) ui_updateWin(win);
+			if (!win.visible) return; //Closed, the depth change draws what was below
+			for (int i = 0; i < win.buttons.size(); i++)
+				if (!changing_depth) ui_updateButton(win.buttons[i]);
+			for (int i = 0; i < win.listboxes.size(); i++)
+				if (!changing_depth) ui_updateListBox(win.listboxes[i]);
+			for (int i = 0; i < win.textboxes.size(); i++)
+				if (!changing_depth) ui_updateTextBox(win.textboxes[i]);
+			for (int i = 0; i < win.sliders.size(); i++)
+				if (!changing_depth) ui_updateSlider(win.sliders[i]);
 
-			//Draw title
-			Fill(win.x, win.y, win.x + win.width, win.y + 8, L' ', (win.focus) ? BG_BLACK : BG_DARK_GREY);
-			str_draw(win.x + (win.width - str_length(win.title)) / 2, win.y + 1, win.title, BG_WHITE);
-			str_draw(win.x + win.width - str_length("ESC") - 1, win.y + 1, "ESC", BG_WHITE);
+			//Everything is drawn again if the window changed or was covered, or a cursor left its textbox
+			Rect frame(win.x - 1, win.y - 1, win.x + win.width + 1, win.y + win.height + 1);
+			if (win.drawn.empty() || win.drawn_focus != win.focus || ui_damage.overlaps(win.drawn)) win.dirty = true;
+			for (int i = 0; i < win.textboxes.size(); i++)
+				if (win.textboxes[i].dirty && !ui_textBoxRect(win.textboxes[i], x, y).contains(win.textboxes[i].drawn)) win.dirty = true;
+
+			if (win.dirty)
+			{
+				//Draw border
+				Fill(win.x - 1, win.y - 1, win.x + win.width + 1, win.y + win.height + 1, L' ', (win.focus) ? BG_BLACK : BG_DARK_GREY);
+
+				//Draw title
+				Fill(win.x, win.y, win.x + win.width, win.y + 8, L' ', (win.focus) ? BG_BLACK : BG_DARK_GREY);
+				str_draw(win.x + (win.width - str_length(win.title)) / 2, win.y + 1, win.title, BG_WHITE);
+				str_draw(win.x + win.width - str_length("ESC") - 1, win.y + 1, "ESC", BG_WHITE);
+
+				//Draw content
+				Fill(win.x, win.y + 8, win.x + win.width, win.y + win.height, L' ', BG_WHITE);
+				for (Label &label : win.labels) label.dirty = true;
+				for (Button &button : win.buttons) button.dirty = true;
+				for (ListBox &listbox : win.listboxes) listbox.dirty = true;
+				for (TextBox &textbox : win.textboxes) textbox.dirty = true;
+				for (Slider &slider : win.sliders) slider.dirty = true;
+
+				win.dirty = false;
+				win.drawn = frame;
+				win.drawn_focus = win.focus;
+				ui_damage.add(frame);
+			}
 
-			//Draw content
-			Fill(win.x, win.y + 8, win.x + win.width, win.y + win.height, L' ', BG_WHITE);
-			int x = win.x,
-				y = win.y + 8,
-				width = win.width,
-				height = win.height - 8;
+			//Draw the children changed
+			Rect painted;
 			//Draw labels
 			for (int i = 0; i < win.labels.size(); i++)
-				ui_drawLabel(win.labels[i], x, y, (win.focus) ? BG_DARK_GREY : BG_GREY);
+				if (win.labels[i].dirty)
+				{
+					painted.add(ui_drawLabel(win.labels[i], x, y, (win.focus) ? BG_DARK_GREY : BG_GREY));
+					win.labels[i].dirty = false;
+				}
 			//Draw buttons
 			for (int i = 0; i < win.buttons.size(); i++)
-				ui_drawButton(win.buttons[i], x, y);
+				if (win.buttons[i].dirty)
+				{
+					painted.add(ui_drawButton(win.buttons[i], x, y));
+					win.buttons[i].dirty = false;
+				}
 			//Draw listboxes
 			for (int i = 0; i < win.listboxes.size(); i++)
-				ui_drawListBox(win.listboxes[i], x, y);
+				if (win.listboxes[i].dirty)
+				{
+					painted.add(ui_drawListBox(win.listboxes[i], x, y));
+					win.listboxes[i].dirty = false;
+				}
 			//Draw textboxes
 			for (int i = 0; i < win.textboxes.size(); i++)
-				ui_drawTextBox(win.textboxes[i], x, y);
+				if (win.textboxes[i].dirty)
+				{
+					win.textboxes[i].drawn = ui_drawTextBox(win.textboxes[i], x, y);
+					painted.add(win.textboxes[i].drawn);
+					win.textboxes[i].dirty = false;
+				}
+			//Draw sliders
+			for (int i = 0; i < win.sliders.size(); i++)
+				if (win.sliders[i].dirty)
+				{
+					painted.add(ui_drawSlider(win.sliders[i], x, y));
+					win.sliders[i].dirty = false;
+				}
+
+			win.drawn.add(painted);
+			ui_damage.add(painted);
+		}
+	}
+	void ui_hideLayer(Rect &drawn, bool visible) //Show the plot again where a hidden menu or window was
+	{
+		if (!visible && !drawn.empty())
+		{
+			restorePlan(drawn);
+			drawn = Rect();
 		}
 	}
+	void ui_drawLayers() //Draw again what a depth change uncovered or changed, bottom to top
+	{
+		ui_damage = Rect(); //The frame drawn so far is up to date with the old depth
+		if (planChanged()) drawPlan();
+
+		ui_hideLayer(main_menu.drawn, main_menu.visible);
+		ui_hideLayer(about_win.drawn, about_win.visible);
+		ui_hideLayer(funcs_win.drawn, funcs_win.visible);
+		ui_hideLayer(funceditor_win.drawn, funceditor_win.visible);
+		ui_hideLayer(params_win.drawn, params_win.visible);
+		ui_hideLayer(error_win.drawn, error_win.visible);
+
+		ui_drawHorMenu(main_menu, 0, 0, m_nScreenWidth);
+		ui_drawWindow(about_win);
+		ui_drawWindow(funcs_win);
+		ui_drawWindow(funceditor_win);
+		ui_drawWindow(params_win);
+		ui_drawWindow(error_win);
+	}
 
 	//CALC GRAPHICS FUNCS
-	void drawPlan()
+	bool planChanged() //Whether the plot layer is out of date
+	{
+		return plot_dirty || (int)plot_layer.size() != m_nScreenWidth * m_nScreenHeight || layer_zoom != zoom || layer_offset_x != offset_x || layer_offset_y != offset_y;
+	}
+	void drawPlan() //Draw the plot, re-rendered only if it changed
 	{
-		//Draw background and axys
-		Fill(0, 0, m_nScreenWidth, m_nScreenHeight, L' ', BG_WHITE);
-		DrawLine(offset_x, 0, offset_x, m_nScreenHeight, L' ', BG_DARK_GREY);
-		DrawLine(0, offset_y, m_nScreenWidth, offset_y, L' ', BG_DARK_GREY);
+		int size = m_nScreenWidth * m_nScreenHeight;
 
-		for (int i = 0; i < graph_funcs.size(); i++)
+		if (planChanged())
 		{
-			//Draw function
-			double last_y = 0;
-			bool last_impossible = true;
-
-			for (int x = 0; x <= m_nScreenWidth; x++)
-			{
-				bool impossible = false;
-				double y;
-
-				try
-				{
-					y = offset_y - round(parsePostfix(graph_funcs[i].postfix_code, (x - offset_x) * zoom) / zoom);
-				}
-				catch (domain_error ex)
-				{
-					impossible = true;
-				}
+			renderPlan();
+			plot_layer.assign(m_bufScreen, m_bufScreen + size);
+			layer_zoom = zoom;
+			layer_offset_x = offset_x;
+			layer_offset_y = offset_y;
+			plot_dirty = false;
+		}
+		else
+		{
+			copy(plot_layer.begin(), plot_layer.end(), m_bufScreen);
+			Invalidate(0, 0, m_nScreenWidth, m_nScreenHeight);
+		}
+		ui_damage.add(Rect(0, 0, m_nScreenWidth, m_nScreenHeight));
+	}
+	void restorePlan(const Rect &rect) //Copy back the plot layer under rect
+	{
+		int x1 = max(rect.x1, 0), x2 = min(rect.x2, m_nScreenWidth);
+		for (int y = max(rect.y1, 0); y < min(rect.y2, m_nScreenHeight) && x1 < x2; y++)
+			copy(plot_layer.begin() + y * m_nScreenWidth + x1, plot_layer.begin() + y * m_nScreenWidth + x2, m_bufScreen + y * m_nScreenWidth + x1);
+		Invalidate(rect.x1, rect.y1, rect.x2, rect.y2);
+		ui_damage.add(rect);
+	}
+	void renderPlan()
+	{
+		//Plot on the canvas, then copy it on the screen
+		if (plot_canvas.width != m_nScreenWidth || plot_canvas.height != m_nScreenHeight) plot_canvas = Canvas(m_nScreenWidth, m_nScreenHeight);
+		evals = renderPlot(graph_funcs, zoom, offset_x, offset_y, use_jit, pool, plot_canvas);
 
-				//Draw line if not impossible or out of screen
-				if (!last_impossible && !impossible && ((last_y > 0 && last_y < m_nScreenHeight) || (y > 0 && y < m_nScreenHeight) || (y <= 0 && last_y >= m_nScreenHeight) || (last_y <= 0 && y >= m_nScreenHeight)))
-					DrawLine(x - 1, last_y, x, y, L' ', graph_funcs[i].color);
-				
-				last_impossible = impossible;
-				last_y = y;
-			}
+		for (int i = 0; i < m_nScreenWidth * m_nScreenHeight; i++)
+		{
+			m_bufScreen[i].Char.UnicodeChar = L' ';
+			m_bufScreen[i].Attributes = plot_canvas.pixels[i];
 		}
+		Invalidate(0, 0, m_nScreenWidth, m_nScreenHeight);
 
 		//Draw cross
 		DrawLine(m_nScreenWidth / 2 - 2, m_nScreenHeight / 2, m_nScreenWidth / 2 + 2, m_nScreenHeight / 2, L' ', BG_BLACK);
@@ -1090,35 +831,30 @@ private:
 		str_draw(m_nScreenWidth - str_length("ZOOM: " + to_string(zoom)) - 1, 1, "ZOOM: " + to_string(zoom), BG_GREY);
 		str_draw(m_nScreenWidth - str_length("X: " + to_string((-offset_x + m_nScreenWidth / 2) * zoom)) - 3, 7, "X : " + to_string((-offset_x + m_nScreenWidth / 2) * zoom), BG_GREY);
 		str_draw(m_nScreenWidth - str_length("Y: " + to_string((offset_y - m_nScreenHeight / 2) * zoom)) - 3, 13, "Y : " + to_string((offset_y - m_nScreenHeight / 2) * zoom), BG_GREY);
+		str_draw(m_nScreenWidth - str_length("EVALS: " + to_string(evals)) - 1, 19, "EVALS: " + to_string(evals), BG_GREY);
 	}
 		
-	void updateFuncsListbox()
+	void updateFuncsListbox(int item_sel = 0) //List graph_funcs, item_sel is kept in range
 	{
-		funcs_win.listboxes[0].item_sel = 0;
+		funcs_win.listboxes[0].item_sel = max(0, min(item_sel, (int)graph_funcs.size() - 1));
 		funcs_win.listboxes[0].headers = { };
 		funcs_win.listboxes[0].funcs = { };
+		funcs_win.listboxes[0].dirty = true;
 
 		for (int i = 0; i < graph_funcs.size(); i++)
 		{
-			funcs_win.listboxes[0].headers.push_back("Y=" + graph_funcs[i].function);
-			funcs_win.listboxes[0].funcs.push_back([=] { 
-				string color = color_name[graph_funcs[funcs_win.listboxes[0].item_sel].color];
-				is_color_av[color] = true;
-				openFuncEditor(i, color);
-			});
+			funcs_win.listboxes[0].headers.push_back((graph_funcs[i].visible ? "" : "HIDDEN: ") + string(graph_funcs[i].relation ? "" : "Y=") + (graph_funcs[i].derived.empty() ? graph_funcs[i].function : graph_funcs[i].derived));
+			funcs_win.listboxes[0].funcs.push_back([=] { openFuncEditor(i); });
 		}
 	}
-	void openFuncEditor(int func_pos, string color = "")
+	void openFuncEditor(int func_pos)
 	{
-		//func_pos == -1 -> new function
-
-		funceditor_win.textboxes[0].content = (func_pos > -1) ? graph_funcs[func_pos].function : "";
-		funceditor_win.textboxes[0].cursor_pos = -1;
-		funceditor_win.listboxes[0].headers.clear();
-		for (auto color : color_name)
-			if (is_color_av[color.second])
-				funceditor_win.listboxes[0].headers.push_back(color.second);
-		funceditor_win.listboxes[0].item_sel = (color == "") ? 0 : distance(funceditor_win.listboxes[0].headers.begin(), find(funceditor_win.listboxes[0].headers.begin(), funceditor_win.listboxes[0].headers.end(), color));
+		//func_pos == -1 -> new function, with the least used color
+
+		ui_setTextBoxContent(funceditor_win.textboxes[0], (func_pos > -1) ? graph_funcs[func_pos].function : "");
+		short color = (func_pos > -1) ? graph_funcs[func_pos].color : paletteNext(graph_funcs);
+		funceditor_win.listboxes[0].item_sel = find_if(plotPalette, plotPalette + PALETTE_SIZE, [&](const PlotColor &entry) { return entry.color == color; }) - plotPalette;
+		funceditor_win.listboxes[0].dirty = true;
 		if (funceditor_win.listboxes[0].item_sel >= funceditor_win.listboxes[0].headers.size())
 		{
 			show_error("UNKNOWN COLOR!");
@@ -1130,12 +866,24 @@ private:
 
 		changeDepth(FUNCEDITOR_WIN);
 	}
+	void setParam(int id, double value) //Move a parameter, only the functions using it are sampled again
+	{
+		paramValues()[id] = value;
+		for (Function &func : graph_funcs)
+			if (func.parametric)
+			{
+				func.cache.zoom = 0; //Every sample depends on it, the parts of x alone and their enclosures stay cached
+				if (func.visible) plot_dirty = true;
+			}
+		changeDepth(PARAMS_WIN);
+	}
 	void show_error(string text)
 	{
 		error_win.labels[0].content = text;
 		error_win.labels[0].x = (error_win.width - str_length(text)) / 2;
 		error_win.onClose_depth = depth;
 		error_win.visible = true;
+		error_win.dirty = true;
 		changeDepth(depth);
 	}
 
@@ -1145,26 +893,6 @@ protected:
 		//Init random generator
 		srand(time(0));
 
-		//Init color maps
-		color_code["BLUE"] = BG_BLUE;
-		color_code["CYAN"] = BG_CYAN;
-		color_code["GREEN"] = BG_GREEN;
-		color_code["MAGENTA"] = BG_MAGENTA;
-		color_code["RED"] = BG_RED;
-		color_code["YELLOW"] = BG_YELLOW;
-		color_name[BG_BLUE] = "BLUE";
-		color_name[BG_CYAN] = "CYAN";
-		color_name[BG_GREEN] = "GREEN";
-		color_name[BG_MAGENTA] = "MAGENTA";
-		color_name[BG_RED] = "RED";
-		color_name[BG_YELLOW] = "YELLOW";
-		is_color_av["BLUE"] = true;
-		is_color_av["CYAN"] = true;
-		is_color_av["GREEN"] = true;
-		is_color_av["MAGENTA"] = true;
-		is_color_av["RED"] = true;
-		is_color_av["YELLOW"] = true;
-
 		//Init functions array
 		graph_funcs = { };
 
@@ -1182,17 +910,22 @@ protected:
 
 		//Init ui components
 #pragma region  main_menu
-		main_menu.headers = { "FUNCTIONS", "ABOUT", "EXIT" };
+		main_menu.headers = { "FUNCTIONS", "PARAMETERS", "ABOUT", "EXIT" };
 		main_menu.funcs =
 		{
 			[&]()
 			{
-				updateFuncsListbox();
+				updateFuncsListbox(funcs_win.listboxes[0].item_sel);
 				ui_changeWindowChild(funcs_win, 0);
 				changeDepth(FUNCS_WIN);
 			},
+			[&]()
+			{
+				ui_changeWindowChild(params_win, 0);
+				changeDepth(PARAMS_WIN);
+			},
 			[&]() { changeDepth(ABOUT_WIN); },
-			[]() { exit(0); },
+			[&]() { m_bAtomActive = false; }, //Start() returns and the terminal is restored
 		};
 		main_menu.onClose_depth = GRAPH;
 #pragma endregion
@@ -1244,7 +977,7 @@ protected:
 		new_btn.x = 9;
 		new_btn.y = funcs_win.height - 19;
 		new_btn.func = [&] { 
-			if (find_if(is_color_av.begin(), is_color_av.end(), [](auto color) { return color.second;}) != is_color_av.end())
+			if (graph_funcs.size() < MAX_FUNCS)
 				openFuncEditor(-1);
 			else
 				show_error("FUNCS LIMIT REACHED!");
@@ -1257,9 +990,9 @@ protected:
 		remove_btn.func = [&] { 
 			if (graph_funcs.size() > 0)
 			{
-				is_color_av[color_name[graph_funcs[funcs_win.listboxes[0].item_sel].color]] = true;
 				graph_funcs.erase(graph_funcs.begin() + funcs_win.listboxes[0].item_sel);
-				updateFuncsListbox();
+				plot_dirty = true;
+				updateFuncsListbox(funcs_win.listboxes[0].item_sel);
 				changeDepth(FUNCS_WIN);
 			}
 			else
@@ -1267,8 +1000,25 @@ protected:
 		};
 		remove_btn.content = "REMOVE";
 
+		Button hide_btn;
+		hide_btn.content = "HIDE";
+		hide_btn.x = (funcs_win.width - str_length(hide_btn.content) - 3) / 2;
+		hide_btn.y = new_btn.y;
+		hide_btn.func = [&] { //Hide or show again the selected function
+			if (graph_funcs.size() > 0)
+			{
+				Function &func = graph_funcs[funcs_win.listboxes[0].item_sel];
+				func.visible = !func.visible;
+				plot_dirty = true;
+				updateFuncsListbox(funcs_win.listboxes[0].item_sel);
+				changeDepth(FUNCS_WIN);
+			}
+			else
+				show_error("FUNCS LIST EMPTY!");
+		};
+
 		funcs_win.listboxes = { funcs_list };
-		funcs_win.buttons = { new_btn, remove_btn };
+		funcs_win.buttons = { new_btn, remove_btn, hide_btn };
 
 		updateFuncsListbox();
 #pragma endregion
@@ -1278,10 +1028,6 @@ protected:
 		funceditor_win.x = (m_nScreenWidth - funceditor_win.width) / 2;
 		funceditor_win.y = (m_nScreenHeight - funceditor_win.height) / 2;
 		funceditor_win.title = "NEW FUNCTION";
-		funceditor_win.onEscape = [&] {
-			if (funceditor_funcpos > -1)
-				is_color_av[color_name[graph_funcs[funceditor_funcpos].color]] = false;
-		};
 		funceditor_win.onClose_depth = FUNCS_WIN;
 
 		Label y_lbl;
@@ -1302,8 +1048,11 @@ protected:
 		ListBox colors_list;
 		colors_list.width = funceditor_win.width - 20;
 		colors_list.rows = 6;
-		colors_list.headers = {};
-		colors_list.funcs = { []() {}, []() {}, []() {}, []() {}, []() {}, []() {} };
+		for (const PlotColor &color : plotPalette)
+		{
+			colors_list.headers.push_back(color.name);
+			colors_list.funcs.push_back([]() {});
+		}
 		colors_list.x = 10;
 		colors_list.y = 36;
 
@@ -1316,40 +1065,29 @@ protected:
 			else
 			{
 				Function func;
-				func.function = funceditor_win.textboxes[0].content;
 
-				//Infix try
-				try
-				{
-					func.postfix_code = parseInfix(func.function);
-				}
-				catch (exception ex)
-				{
-					show_error(ex.what());
-					return;
-				}
-				//Postfix try
+				//Parse and compile try
 				try
 				{
-					parsePostfix(func.postfix_code, rand() % 1000 + (rand() % 100) / 100);
+					func = compileFunction(funceditor_win.textboxes[0].content);
 				}
-				catch (invalid_argument ex)
+				catch (const exception &ex)
 				{
 					show_error(ex.what());
 					return;
 				}
-				catch (domain_error ex)
-				{
-					/* CALCULATION ERRORS ARE NOT HANDLED */
-				}
 
-				func.color = color_code[funceditor_win.listboxes[0].headers[funceditor_win.listboxes[0].item_sel]];
-				is_color_av[color_name[func.color]] = false; //Remove color from list
+				func.color = plotPalette[funceditor_win.listboxes[0].item_sel].color;
 
-				if (funceditor_funcpos > -1) graph_funcs[funceditor_funcpos] = func;
+				if (funceditor_funcpos > -1)
+				{
+					func.visible = graph_funcs[funceditor_funcpos].visible; //An edit does not show a hidden function
+					graph_funcs[funceditor_funcpos] = func;
+				}
 				else graph_funcs.push_back(func);
+				plot_dirty = true;
 
-				updateFuncsListbox();
+				updateFuncsListbox((funceditor_funcpos > -1) ? funceditor_funcpos : graph_funcs.size() - 1);
 			}
 			changeDepth(FUNCS_WIN);
 		};
@@ -1360,6 +1098,32 @@ protected:
 		funceditor_win.listboxes = { colors_list };
 		funceditor_win.buttons = { ok_btn };
 #pragma endregion
+#pragma region params_win
+		params_win.width = 150;
+		params_win.height = 60;
+		params_win.x = (m_nScreenWidth - params_win.width) / 2;
+		params_win.y = m_nScreenHeight - params_win.height - 2; //The plot stays visible above
+		params_win.title = "PARAMETERS";
+		params_win.onClose_depth = MAIN_MENU;
+
+		for (int i = 0; i < EXPR_PARAMS; i++)
+		{
+			Label param_lbl;
+			param_lbl.content = string(1, 'A' + i);
+			param_lbl.x = 8;
+			param_lbl.y = 7 + i * 11;
+
+			Slider param_sld;
+			param_sld.value = paramValues()[i];
+			param_sld.width = params_win.width - 26;
+			param_sld.x = 18;
+			param_sld.y = 6 + i * 11;
+			param_sld.func = [=] { setParam(i, params_win.sliders[i].value); };
+
+			params_win.labels.push_back(param_lbl);
+			params_win.sliders.push_back(param_sld);
+		}
+#pragma endregion
 #pragma region error_win
 		error_win.width = 110;
 		error_win.height = 50;
@@ -1379,7 +1143,8 @@ protected:
 	}
 	virtual bool OnUserUpdate(float fElapsedTime) 
 	{
-		//Draw & update
+		//Draw & update, only what changed
+		ui_damage = Rect();
 	 	ui_drawDepth();
 
 		//Graph updater
@@ -1425,6 +1190,14 @@ protected:
 
 					drawPlan();
 				}
+				else if (m_keys['J'].bPressed)
+				{
+					use_jit = !use_jit;
+					for (Function &func : graph_funcs) func.cache.zoom = 0; //Sample again with the other backend
+					plot_dirty = true;
+
+					drawPlan();
+				}
 
 			}
 		}
@@ -1432,13 +1205,8 @@ protected:
 		//If depth has changed...
 		if (changing_depth)
 		{
-			//...redraw everything
-			drawPlan();
-			ui_drawHorMenu(main_menu, 0, 0, m_nScreenWidth);
-			ui_drawWindow(about_win);
-			ui_drawWindow(funcs_win);
-			ui_drawWindow(funceditor_win);
-			ui_drawWindow(error_win);
+			//...redraw the menus and windows changed, and the plot under the closed ones
+			ui_drawLayers();
 
 			changing_depth = false;
 		}
@@ -1447,9 +1215,90 @@ protected:
 	}
 };
 
-int main() {
+/* COMMAND LINE */
+int renderCommand(int argc, char **argv) //Plot to an image without a console, returns the exit code
+{
+	vector<Function> funcs;
+	double zoom = 0.01, center_x = 0, center_y = 0;
+	int width = 1024, height = 1024;
+	string out;
+
+	try
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			string arg = argv[i];
+			auto value = [&]() -> string
+			{
+				if (i + 1 >= argc) throw runtime_error("Missing value after " + arg);
+				return argv[++i];
+			};
+
+			if (arg == "--render")
+			{
+				funcs.push_back(compileFunction(value()));
+				funcs.back().color = plotPalette[(funcs.size() - 1) % PALETTE_SIZE].color; //Given in turn
+			}
+			else if (arg == "--color")
+			{
+				string name = value();
+				transform(name.begin(), name.end(), name.begin(), ::toupper);
+				replace(name.begin(), name.end(), '_', ' '); //DARK_BLUE
+				if (funcs.empty() || paletteFind(name) < 0) throw runtime_error("Bad --color " + name);
+				funcs.back().color = plotPalette[paletteFind(name)].color;
+			}
+			else if (arg == "--param")
+			{
+				string name = value();
+				int id = (name.size() == 1) ? paramId(tolower(name[0])) : -1;
+				if (id < 0) throw runtime_error("Bad --param " + name);
+				paramValues()[id] = stod(value());
+			}
+			else if (arg == "--zoom")
+			{
+				zoom = stod(value());
+				if (!(zoom > 0)) throw runtime_error("Bad --zoom");
+			}
+			else if (arg == "--center")
+			{
+				center_x = stod(value());
+				center_y = stod(value());
+			}
+			else if (arg == "--size")
+			{
+				if (sscanf(value().c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) throw runtime_error("Bad --size, use WIDTHxHEIGHT");
+			}
+			else if (arg == "--out") out = value();
+			else throw runtime_error("Unknown option " + arg);
+		}
+		if (funcs.empty() || out.empty()) throw runtime_error("Missing --render or --out");
+	}
+	catch (const exception &ex)
+	{
+		fprintf(stderr, "ERROR: %s\n", ex.what());
+		fprintf(stderr, "Usage: %s --render EXPR [--color NAME] [--render EXPR ...] [--param NAME VALUE] [--zoom UNITS_PER_PIXEL] [--center X Y] [--size WIDTHxHEIGHT] --out FILE.png|FILE.ppm\n", argv[0]);
+		return 1;
+	}
+
+	Canvas canvas(width, height);
+	WorkerPool pool;
+	renderPlot(funcs, zoom, width / 2 - (int)round(center_x / zoom), height / 2 + (int)round(center_y / zoom), true, pool, canvas);
+
+	bool ppm = out.size() >= 4 && out.compare(out.size() - 4, 4, ".ppm") == 0;
+	if (!(ppm ? savePPM(canvas, out) : savePNG(canvas, out)))
+	{
+		fprintf(stderr, "ERROR: Cannot write %s\n", out.c_str());
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1) return renderCommand(argc, argv); //Headless
+
 	Environment env;
-	env.ConstructConsole(SCREEN_W, SCREEN_H, 2, 2);
+	if (env.ConstructConsole(SCREEN_W, SCREEN_H, 2, 2) != 1) return 1;
 	env.Start();
 
 	return 0;
@@ -2,16 +2,29 @@
 #include <stack>
 #include <math.h>
 #include <sstream>
+#include <iomanip>
 #include <algorithm>
+#include <memory>
+#include <unordered_map>
 #include <stdexcept>
 
 using namespace std;
 #define E 2.71828182846
 #define PI 3.14159265359
 #define DX 0.00000000001
+#define EXPR_MAX_STACK 1024 //Maximum evaluation stack depth
+#define EXPR_DIFF_STACK 256 //Maximum stack depth of a diff() argument
+#define EXPR_MAX_DIFF 3 //Maximum number of nested diff()
+#define EXPR_PARAMS 4 //Free parameters, the letters from 'a'
 
 #pragma once
 /* HELPERS */
+enum EVAL_STATUS //Evaluation status flags
+{
+	EVAL_OK = 0,
+	EVAL_ZERO_DIV = 1, //A division by zero happened
+	EVAL_NOT_FINITE = 2 //The result is NaN or infinite
+};
 void error(int type, const char* cause) //throw a custom error
 {
 	/*
@@ -29,6 +42,11 @@ void error(int type, const char* cause) //throw a custom error
 		break;
 	}
 }
+bool isFuncName(const string &name) //Two letters at least, then letters or digits
+{
+	if (name.length() < 2 || !islower(name.at(0)) || !islower(name.at(1))) return false;
+	return all_of(name.begin(), name.end(), [](char c) { return islower(c) || isdigit(c); });
+}
 bool isNumber(string num)
 {
 	if (num.length() == 0) return false;
@@ -51,132 +69,262 @@ bool higherOrEqPrecOp(char op_a, char op_b)
 
 	return op_a >= op_b;
 } 
-string searchClosedPar(string container, unsigned int &i) //Find the closer parenthesis
+void popOperators(stack<char> &op_stack, vector<string> &out_queue, char token) //Move the stronger operators into the queue
 {
-	string res = "";
-	int p_opened_c = 1; //Number of opened parenthesis
-
-	i++; //Parenthesis correction
-	for(i; i < container.length() && p_opened_c > 0; i++)
+	while (op_stack.size() > 0 && op_stack.top() != '(' && higherOrEqPrecOp(op_stack.top(), token))
 	{
-		char token = container.at(i);
-		
-		if (token == '(') p_opened_c++;
-		if (token == ')') p_opened_c--;
-
-		res += token;
+		out_queue.push_back(string(1, op_stack.top()));
+		op_stack.pop();
 	}
-	if (p_opened_c > 0) error(0, "Missing ')'!");
-	i--;
+}
+
+/* PARAMETERS */
+double* paramValues() //Current value of every parameter, read by all the evaluators
+{
+	static double values[EXPR_PARAMS] = { 1, 1, 1, 1 };
+	return values;
+}
+int paramId(char letter) { return (letter >= 'a' && letter < 'a' + EXPR_PARAMS) ? letter - 'a' : -1; } //-1 if letter is not a parameter
+
+/* FUNCTIONS */
+enum FUNC_ID //Builtins, in registration order
+{
+	FN_ABS = 0,
+	FN_COS, FN_SIN, FN_TAN,
+	FN_ACOS, FN_ASIN, FN_ATAN,
+	FN_COSH, FN_SINH, FN_TANH,
+	FN_ACOSH, FN_ASINH, FN_ATANH,
+	FN_SQRT, FN_CBRT, FN_EXP, FN_LN,
+	FN_DIFF,
+	FN_FLOOR, FN_MIN, FN_MAX, FN_ATAN2,
+	FN_BUILTINS //First id free for registered functions
+};
+typedef double(*UnaryFunc)(double);
+typedef double(*BinaryFunc)(double, double);
+struct FuncDef
+{
+	string name;
+	int arity = 1; //Number of arguments
+	UnaryFunc unary = nullptr;
+	BinaryFunc binary = nullptr;
+	int derivative = -1; //Registered unary functions: id of f', -1 if unknown
+};
+struct FuncRegistry
+{
+	vector<FuncDef> defs; //Indexed by function id
+	unordered_map<string, int> ids; //Name lookup in constant time
+};
+
+int addFunc(FuncRegistry &reg, const FuncDef &def)
+{
+	if (!isFuncName(def.name)) error(0, "Invalid function name!");
+	if (reg.ids.count(def.name) > 0) error(0, "Function already registered!");
+
+	reg.defs.push_back(def);
+	reg.ids[def.name] = reg.defs.size() - 1;
+	return reg.defs.size() - 1;
+}
+int addFunc(FuncRegistry &reg, const string &name, UnaryFunc func, int derivative = -1)
+{
+	FuncDef def;
+	def.name = name;
+	def.unary = func;
+	def.derivative = derivative;
+	return addFunc(reg, def);
+}
+int addFunc(FuncRegistry &reg, const string &name, BinaryFunc func)
+{
+	FuncDef def;
+	def.name = name;
+	def.arity = 2;
+	def.binary = func;
+	return addFunc(reg, def);
+}
+FuncRegistry builtinFuncs() //Same order of FUNC_ID
+{
+	FuncRegistry reg;
+
+	addFunc(reg, "abs", [](double a) { return abs(a); });
+	addFunc(reg, "cos", [](double a) { return cos(a); });
+	addFunc(reg, "sin", [](double a) { return sin(a); });
+	addFunc(reg, "tan", [](double a) { return tan(a); });
+	addFunc(reg, "acos", [](double a) { return acos(a); });
+	addFunc(reg, "asin", [](double a) { return asin(a); });
+	addFunc(reg, "atan", [](double a) { return atan(a); });
+	addFunc(reg, "cosh", [](double a) { return cosh(a); });
+	addFunc(reg, "sinh", [](double a) { return sinh(a); });
+	addFunc(reg, "tanh", [](double a) { return tanh(a); });
+	addFunc(reg, "acosh", [](double a) { return acosh(a); });
+	addFunc(reg, "asinh", [](double a) { return asinh(a); });
+	addFunc(reg, "atanh", [](double a) { return atanh(a); });
+	addFunc(reg, "sqrt", [](double a) { return sqrt(a); });
+	addFunc(reg, "cbrt", [](double a) { return cbrt(a); });
+	addFunc(reg, "exp", [](double a) { return exp(a); });
+	addFunc(reg, "ln", [](double a) { return log(a); });
+	addFunc(reg, "diff", (UnaryFunc)nullptr); //Handled by the compilers
+	addFunc(reg, "floor", [](double a) { return floor(a); });
+	addFunc(reg, "min", [](double a, double b) { return fmin(a, b); });
+	addFunc(reg, "max", [](double a, double b) { return fmax(a, b); });
+	addFunc(reg, "atan2", [](double a, double b) { return atan2(a, b); });
+
+	return reg;
+}
+FuncRegistry& funcRegistry()
+{
+	static FuncRegistry reg = builtinFuncs();
+	return reg;
+}
+int registerFunc(const string &name, UnaryFunc func, int derivative = -1) //Add a function usable in expressions, returns its id
+{
+	if (derivative >= (int)funcRegistry().defs.size() || (derivative >= 0 && funcRegistry().defs[derivative].arity != 1))
+		error(0, "Invalid derivative!");
+	return addFunc(funcRegistry(), name, func, derivative);
+}
+int registerFunc(const string &name, BinaryFunc func)
+{
+	return addFunc(funcRegistry(), name, func);
+}
+const FuncDef& getFunc(int id) { return funcRegistry().defs[id]; }
+int getFuncId(const string &func) //Resolve a function name, -1 if unknown
+{
+	const FuncRegistry &reg = funcRegistry();
+	auto it = reg.ids.find(func);
 
-	return res.substr(0, res.length() - 1);
+	return (it == reg.ids.end()) ? -1 : it->second;
 }
+double applyFunc(int id, double a) { return getFunc(id).unary(a); }
+double applyFunc(int id, double a, double b) { return getFunc(id).binary(a, b); }
 
 /* PARSERS */
-vector<string> parseInfix(string in_expr)
+vector<string> parseInfix(const string &expr)
 {
 	//Empty correction
-	if (in_expr.length() == 0) error(0, "Argument empty!");
-
-	//First negative correction
-	string expr(in_expr.length() + 1, '\0');
-	expr = (in_expr.at(0) == '-') ? '0' + in_expr : in_expr;
+	if (expr.length() == 0) error(0, "Argument empty!");
 
 	/* SHUNTING-YARD */
 	//vars
 	stack<char> op_stack;
+	stack<int> par_stack; //For every open parenthesis: position of its function length in out_queue, -1 if not a function
 	vector<string> out_queue;
+	bool relation = false, //An '=' was found
+		uses_y = false;
 
 	//code
 	for (unsigned int i = 0; i < expr.length(); i++)
 	{
 		char token = expr.at(i);
+		bool at_begin = i == 0 || expr.at(i - 1) == '(' || expr.at(i - 1) == ',' || expr.at(i - 1) == '='; //Start of an (sub)expression
 
-		//function check
-		bool is_func = true;
-		if (isalpha(token))
-		{
-			if (i == expr.length() - 1)
-				is_func = false;
-			else if (!isalpha(expr.at(i + 1)))
-				is_func = false;
-		}
-		else is_func = false;
-		
 		//Case function
-		if (is_func)
+		if (isalpha(token) && i + 1 < expr.length() && isalpha(expr.at(i + 1)))
 		{
 			//get the function
-			string func = "";
-			while (isalpha(expr.at(i)))
+			unsigned int name_begin = i;
+			while (isalnum(expr.at(i)))
 			{
-				func += expr.at(i);
 				i++;
 				if (i == expr.length()) error(0, "Missing '('!");
 			}
 			if (expr.at(i) != '(')
 				error(0, "Missing '('!");
 
-			//get the argument
-			string argument = searchClosedPar(expr, i); //Function argument
-
-			//parse function
-			vector<string> postfix_arg = parseInfix(argument);
-			out_queue.push_back(func);
-			out_queue.push_back(to_string(postfix_arg.size()));
-			out_queue.insert(out_queue.end(), postfix_arg.begin(), postfix_arg.end());
-
+			//the argument length is known when the parenthesis closes
+			out_queue.push_back(expr.substr(name_begin, i - name_begin));
+			out_queue.push_back("");
+			par_stack.push(out_queue.size() - 1);
+			op_stack.push('(');
 		}
-		else
+		//Case constant/variable
+		else if (token == 'x' || token == 'y' || token == 'e' || token == 'p' || paramId(token) != -1)
 		{
-			//Case constant/variable
-			if (token == 'x' || token == 'e' || token == 'p')
-			{
-				out_queue.push_back(string(1, token));
-			}
-			//Case number
-			else if ((token - '0') >= 0 && (token - '0') <= 9)
+			if (token == 'y') uses_y = true;
+			out_queue.push_back(string(1, token));
+		}
+		//Case number
+		else if ((token - '0') >= 0 && (token - '0') <= 9)
+		{
+			unsigned int num_begin = i;
+			do
 			{
-				string final_num = "";
-				do
-				{
-					final_num += expr.at(i);
-					i++;
-					if (i == expr.length()) break;
-				} while ((expr.at(i) - '0') >= 0 && (expr.at(i) - '0') <= 9 || expr.at(i) == '.');
-				i--;
+				i++;
+				if (i == expr.length()) break;
+			} while ((expr.at(i) - '0') >= 0 && (expr.at(i) - '0') <= 9 || expr.at(i) == '.');
 
-				if (!isNumber(final_num)) error(0, "Syntax error!");
+			string final_num = expr.substr(num_begin, i - num_begin);
+			i--;
 
-				out_queue.push_back(final_num);
-			}
-			//Case operator
-			else if (token == '+' || token == '-' || token == '*' || token == '/' || token == '^')
-			{
-				if (op_stack.size() > 0)
-					while (higherOrEqPrecOp(op_stack.top(), token))
-					{
-						out_queue.push_back(string(1, op_stack.top()));
-						op_stack.pop();
+			if (!isNumber(final_num)) error(0, "Syntax error!");
+
+			out_queue.push_back(final_num);
+		}
+		//Case operator
+		else if (token == '+' || token == '-' || token == '*' || token == '/' || token == '^')
+		{
+			//First negative correction
+			if (token == '-' && at_begin) out_queue.push_back("0");
 
-						if (op_stack.size() == 0) break; //Exit if there are no elements in stack
-					}
+			popOperators(op_stack, out_queue, token);
+			op_stack.push(token);
+		}
+		//Case left bracket
+		else if (token == '(')
+		{
+			par_stack.push(-1);
+			op_stack.push('(');
+		}
+		//Case relation: lhs=rhs is the zero set of lhs-(rhs)
+		else if (token == '=')
+		{
+			if (relation) error(0, "Unexpected '='!");
+			if (par_stack.size() > 0) error(0, "Missing ')'!");
+			if (at_begin) error(0, "Argument empty!");
 
-				op_stack.push(token);
+			//Out the lhs ops, '=' goes out last
+			while (op_stack.size() > 0)
+			{
+				out_queue.push_back(string(1, op_stack.top()));
+				op_stack.pop();
 			}
-			//Case left bracket
-			else if (token == '(')
+			relation = true;
+		}
+		//Case argument separator
+		else if (token == ',')
+		{
+			if (par_stack.size() == 0 || par_stack.top() == -1) error(0, "Unexpected ','!");
+			if (at_begin) error(0, "Argument empty!");
+
+			//Out the argument ops
+			while (op_stack.top() != '(')
 			{
-				//GET THE CONTENT
-				string content = searchClosedPar(expr, i); //Parenthesis content
+				out_queue.push_back(string(1, op_stack.top()));
+				op_stack.pop();
+			}
+		}
+		//Case right bracket
+		else if (token == ')')
+		{
+			if (par_stack.size() == 0) error(0, "Missing '('!");
+			if (at_begin) error(0, "Argument empty!");
 
-				vector<string> postfix_content = parseInfix(content);
-				out_queue.insert(out_queue.end(), postfix_content.begin(), postfix_content.end());
+			//Out the parenthesis ops
+			while (op_stack.top() != '(')
+			{
+				out_queue.push_back(string(1, op_stack.top()));
+				op_stack.pop();
 			}
-			//Unknow
-			else error(0, "Unknown token!");
+			op_stack.pop();
+
+			//Set the function argument length
+			int len_pos = par_stack.top();
+			par_stack.pop();
+			if (len_pos > -1) out_queue[len_pos] = to_string(out_queue.size() - len_pos - 1);
 		}
+		//Unknow
+		else error(0, "Unknown token!");
 	}
+	if (par_stack.size() > 0) error(0, "Missing ')'!");
+	if (relation && expr.back() == '=') error(0, "Argument empty!");
+	if (uses_y && !relation) error(0, "Missing '='!");
 
 	//Out all ops
 	while (op_stack.size() > 0)
@@ -184,81 +332,79 @@ vector<string> parseInfix(string in_expr)
 		out_queue.push_back(string(1, op_stack.top()));
 		op_stack.pop();
 	}
+	if (relation) out_queue.push_back("=");
 
 	return out_queue;
 }
-double parsePostfix(vector<string> postfix_expr, double x)
+bool isRelation(const vector<string> &postfix_expr) { return postfix_expr.size() > 0 && postfix_expr.back() == "="; } //F(x, y) = 0 instead of y = F(x)
+int parsePostfixRange(const vector<string> &postfix_expr, unsigned int begin, unsigned int end, double x, double y, double* nums, int capacity, int *status) //Compute postfix_expr[begin, end) using nums as stack, returns the values left
 {
-	/* Compute postfix */
-	//vars
-	stack<double> nums;
+	int top = -1;
 
 	//code
-	for (unsigned int i = 0; i < postfix_expr.size(); i++) {
-		char token = postfix_expr[i].at(0);
+	for (unsigned int i = begin; i < end; i++) {
+		const string &token_str = postfix_expr[i];
+		char token = token_str.at(0);
+		double result = NAN;
+
+		if (top + 1 >= capacity) error(0, "Expression too complex!");
 
 		//case function
- 		if (isalpha(token) && postfix_expr[i].length() > 1)
+		if (isalpha(token) && token_str.length() > 1)
 		{
-			string func = postfix_expr[i];
-			i++;
+			int id = getFuncId(token_str);
+			if (id == -1) error(0, "Unknown function!");
+			if (i + 1 >= end) error(0, "Syntax error!");
 
-			unsigned int stop_pos = stoi(postfix_expr[i].c_str()) + i;
-			i++;
+			//The arguments are computed in place, above the current stack
+			unsigned int arg_begin = i + 2,
+				arg_end = arg_begin + atoi(postfix_expr[i + 1].c_str());
+			if (arg_end > end) error(0, "Syntax error!");
 
-			vector<string> content;
-			for (i; i <= stop_pos; i++)
-				content.push_back(postfix_expr[i]);
-			i--;
+			double *args = nums + top + 1;
+			if (parsePostfixRange(postfix_expr, arg_begin, arg_end, x, y, args, capacity - top - 1, status) != getFunc(id).arity)
+				error(0, "Wrong number of arguments!");
 
-			double argument = parsePostfix(content, x);
-
-			if (func == "abs") nums.push(abs(argument));
-			else if (func == "cos") nums.push(cos(argument));
-			else if (func == "sin") nums.push(sin(argument));
-			else if (func == "tan") nums.push(tan(argument));
-			else if (func == "acos") nums.push(acos(argument));
-			else if (func == "asin") nums.push(asin(argument));
-			else if (func == "atan") nums.push(atan(argument));
-			else if (func == "cosh") nums.push(cosh(argument));
-			else if (func == "sinh") nums.push(sinh(argument));
-			else if (func == "tanh") nums.push(tanh(argument));
-			else if (func == "acosh") nums.push(acosh(argument));
-			else if (func == "asinh") nums.push(asinh(argument));
-			else if (func == "atanh") nums.push(atanh(argument));
-			else if (func == "sqrt") nums.push(sqrt(argument));
-			else if (func == "cbrt") nums.push(cbrt(argument));
-			else if (func == "exp") nums.push(exp(argument));
-			else if (func == "ln") nums.push(log(argument));
-			else if (func == "diff") nums.push((parsePostfix(content, x + DX) - argument) / DX);
-			else error(0, "Unknokn function!");
+			if (id == FN_DIFF)
+			{
+				double argument = args[0];
+				parsePostfixRange(postfix_expr, arg_begin, arg_end, x + DX, y, args, capacity - top - 1, status);
+				result = (args[0] - argument) / DX;
+			}
+			else if (getFunc(id).arity == 2) result = applyFunc(id, args[0], args[1]);
+			else result = applyFunc(id, args[0]);
+
+			nums[++top] = result;
+			i = arg_end - 1;
 		}
 		else
 		{
 			//case variable
 			if (token == 'x')
-				nums.push(x);
+				nums[++top] = x;
+			else if (token == 'y')
+				nums[++top] = y;
 			else if (token == 'e')
-				nums.push(E);
+				nums[++top] = E;
 			else if (token == 'p')
-				nums.push(PI);
+				nums[++top] = PI;
+			else if (paramId(token) != -1)
+				nums[++top] = paramValues()[paramId(token)];
 
 			//Case number
 			else if ((token - '0') >= 0 && (token - '0') <= 9)
-				nums.push(atof(postfix_expr[i].c_str()));
+				nums[++top] = atof(token_str.c_str());
 
 			//Case operator
 			else
 			{
-				double a, b, result;
+				double a, b;
 
-				if (nums.size() < 2)
+				if (top < 1)
 					error(0, "Syntax error!");
 
-				b = nums.top();
-				nums.pop();
-				a = nums.top();
-				nums.pop();
+				b = nums[top--];
+				a = nums[top];
 
 				switch (token)
 				{
@@ -266,13 +412,14 @@ double parsePostfix(vector<string> postfix_expr, double x)
 					result = a + b;
 					break;
 				case '-':
+				case '=':
 					result = a - b;
 					break;
 				case '*':
 					result = a * b;
 					break;
 				case '/':
-					if (b == 0) error(1, "Zero division!");
+					if (b == 0 && status) *status |= EVAL_ZERO_DIV;
 					result = a / b;
 					break;
 				case '^':
@@ -282,10 +429,1238 @@ double parsePostfix(vector<string> postfix_expr, double x)
 					error(0, "Unknown token!");
 				}
 
-				nums.push(result);
+				nums[top] = result;
+			}
+		}
+	}
+	if (top == -1) error(0, "Argument empty!");
+
+	return top + 1;
+}
+double parsePostfix(const vector<string> &postfix_expr, double x, double y, int *status = nullptr) //y is only used by relations
+{
+	/* Compute postfix */
+	double nums[EXPR_MAX_STACK];
+
+	int count = parsePostfixRange(postfix_expr, 0, postfix_expr.size(), x, y, nums, EXPR_MAX_STACK, status);
+	if (count > 1) error(0, "Syntax error!");
+	double res = nums[count - 1];
+	if (status && !isfinite(res)) *status |= EVAL_NOT_FINITE;
+
+	return res;
+}
+double parsePostfix(const vector<string> &postfix_expr, double x, int *status = nullptr) { return parsePostfix(postfix_expr, x, NAN, status); }
+
+/* BYTECODE */
+enum OPCODE
+{
+	OP_NUM = 0, //Push a constant
+	OP_VAR_X = 1, //Push x
+	OP_ADD = 2,
+	OP_SUB = 3,
+	OP_MUL = 4,
+	OP_DIV = 5,
+	OP_POW = 6,
+	OP_FUNC = 7, //Apply a function to the top of the stack
+	OP_DIFF = 8, //Derivative of the next 'arg' instructions
+	OP_SQUARE = 9, //Square the top, x^2 of the optimizer
+	OP_FUNC2 = 10, //Apply a binary function to the top two values
+	OP_VAR_Y = 11, //Push y (relations)
+	OP_PARAM = 12, //Push the value of a parameter
+	OP_SLOT = 13 //Push a value given by the caller (batch evaluator only)
+};
+struct Instruction
+{
+	OPCODE op;
+	double value = 0; //OP_NUM: constant
+	int arg = 0; //OP_FUNC/OP_FUNC2: function id, OP_DIFF: argument length, OP_PARAM/OP_SLOT: index
+};
+struct Program
+{
+	vector<Instruction> code;
+	int max_depth = 0; //Stack slots needed to run the program
+};
+
+/* COMPILER */
+int compileRange(const vector<string> &postfix_expr, unsigned int begin, unsigned int end, Program &prog, int &depth, int diff_level = 0) //Returns the peak depth
+{
+	int peak = depth;
+
+	for (unsigned int i = begin; i < end; i++)
+	{
+		const string &tok = postfix_expr[i];
+		char token = tok.at(0);
+		Instruction ins;
+
+		//case function
+		if (isalpha(token) && tok.length() > 1)
+		{
+			int id = getFuncId(tok);
+			if (id == -1) error(0, "Unknown function!");
+
+			i++;
+			if (i >= end) error(0, "Syntax error!");
+			unsigned int arg_begin = i + 1,
+				arg_end = arg_begin + stoi(postfix_expr[i]);
+			if (arg_end > end) error(0, "Syntax error!");
+
+			int depth_before = depth;
+			unsigned int arg_pos = prog.code.size();
+
+			if (id == FN_DIFF)
+			{
+				//the argument runs on its own stack of dual numbers
+				if (diff_level == EXPR_MAX_DIFF) error(0, "Too many nested diff!");
+
+				int arg_depth = 0;
+				int arg_peak = compileRange(postfix_expr, arg_begin, arg_end, prog, arg_depth, diff_level + 1);
+				if (arg_depth == 0) error(0, "Argument empty!");
+				if (arg_depth != 1) error(0, "Wrong number of arguments!");
+				if (arg_peak > EXPR_DIFF_STACK) error(0, "Expression too complex!");
+
+				ins.op = OP_DIFF;
+				ins.arg = prog.code.size() - arg_pos;
+				prog.code.insert(prog.code.begin() + arg_pos, ins);
+				peak = max(peak, depth_before + 1);
+			}
+			else
+			{
+				int arg_peak = compileRange(postfix_expr, arg_begin, arg_end, prog, depth, diff_level);
+				if (depth == depth_before) error(0, "Argument empty!");
+				if (depth - depth_before != getFunc(id).arity) error(0, "Wrong number of arguments!");
+
+				ins.op = (getFunc(id).arity == 2) ? OP_FUNC2 : OP_FUNC;
+				ins.arg = id;
+				prog.code.push_back(ins);
+				peak = max(peak, arg_peak);
+			}
+			depth = depth_before + 1;
+
+			i = arg_end - 1;
+			continue;
+		}
+
+		//case variable
+		if (token == 'x')
+			ins.op = OP_VAR_X;
+		else if (token == 'y')
+			ins.op = OP_VAR_Y;
+		else if (paramId(token) != -1)
+		{
+			ins.op = OP_PARAM;
+			ins.arg = paramId(token);
+		}
+		else if (token == 'e' || token == 'p')
+		{
+			ins.op = OP_NUM;
+			ins.value = (token == 'e') ? E : PI;
+		}
+		//Case number
+		else if ((token - '0') >= 0 && (token - '0') <= 9)
+		{
+			ins.op = OP_NUM;
+			ins.value = atof(tok.c_str());
+		}
+		//Case operator
+		else
+		{
+			if (depth < 2) error(0, "Syntax error!");
+
+			switch (token)
+			{
+			case '+': ins.op = OP_ADD; break;
+			case '-': case '=': ins.op = OP_SUB; break;
+			case '*': ins.op = OP_MUL; break;
+			case '/': ins.op = OP_DIV; break;
+			case '^': ins.op = OP_POW; break;
+			default:
+				error(0, "Unknown token!");
+			}
+			prog.code.push_back(ins);
+			depth--;
+			continue;
+		}
+
+		prog.code.push_back(ins);
+		depth++;
+		peak = max(peak, depth);
+	}
+
+	return peak;
+}
+Program compilePostfix(const vector<string> &postfix_expr) //Translate the postfix tokens into bytecode
+{
+	Program prog;
+	int depth = 0;
+
+	prog.max_depth = compileRange(postfix_expr, 0, postfix_expr.size(), prog, depth);
+	if (depth == 0) error(0, "Argument empty!");
+	if (prog.max_depth > EXPR_MAX_STACK) error(0, "Expression too complex!");
+
+	return prog;
+}
+
+/* EVALUATOR */
+template<typename T> struct Dual //Value and derivative, nested for higher orders
+{
+	T v, d;
+
+	Dual() : v(0), d(0) {}
+	Dual(double c) : v(c), d(0) {}
+	Dual(const T &v, const T &d) : v(v), d(d) {}
+};
+template<typename T> struct DiffOrder { enum { value = 0 }; };
+template<typename T> struct DiffOrder<Dual<T>> { enum { value = DiffOrder<T>::value + 1 }; };
+
+double real(double a) { return a; }
+template<typename T> double real(const Dual<T> &a) { return real(a.v); }
+
+template<typename T> Dual<T> operator+(const Dual<T> &a, const Dual<T> &b) { return Dual<T>(a.v + b.v, a.d + b.d); }
+template<typename T> Dual<T> operator-(const Dual<T> &a, const Dual<T> &b) { return Dual<T>(a.v - b.v, a.d - b.d); }
+template<typename T> Dual<T> operator-(const Dual<T> &a) { return Dual<T>(T(0) - a.v, T(0) - a.d); }
+template<typename T> Dual<T> operator*(const Dual<T> &a, const Dual<T> &b) { return Dual<T>(a.v * b.v, a.d * b.v + a.v * b.d); }
+template<typename T> Dual<T> operator/(const Dual<T> &a, const Dual<T> &b) { return Dual<T>(a.v / b.v, (a.d * b.v - a.v * b.d) / (b.v * b.v)); }
+
+template<typename T> Dual<T> applyFunc(int id, const Dual<T> &a) //Chain rule: f(v + d) = f(v) + f'(v) * d
+{
+	const T &v = a.v;
+	const T one(1);
+	T der; //f'(v)
+
+	switch (id)
+	{
+	case FN_ABS: return (real(v) < 0) ? -a : a;
+	case FN_COS: der = T(0) - applyFunc(FN_SIN, v); break;
+	case FN_SIN: der = applyFunc(FN_COS, v); break;
+	case FN_TAN: der = one / (applyFunc(FN_COS, v) * applyFunc(FN_COS, v)); break;
+	case FN_ACOS: der = T(0) - one / applyFunc(FN_SQRT, one - v * v); break;
+	case FN_ASIN: der = one / applyFunc(FN_SQRT, one - v * v); break;
+	case FN_ATAN: der = one / (one + v * v); break;
+	case FN_COSH: der = applyFunc(FN_SINH, v); break;
+	case FN_SINH: der = applyFunc(FN_COSH, v); break;
+	case FN_TANH: der = one / (applyFunc(FN_COSH, v) * applyFunc(FN_COSH, v)); break;
+	case FN_ACOSH: der = one / applyFunc(FN_SQRT, v * v - one); break;
+	case FN_ASINH: der = one / applyFunc(FN_SQRT, v * v + one); break;
+	case FN_ATANH: der = one / (one - v * v); break;
+	case FN_SQRT: der = one / (T(2) * applyFunc(FN_SQRT, v)); break;
+	case FN_CBRT: der = one / (T(3) * applyFunc(FN_CBRT, v) * applyFunc(FN_CBRT, v)); break;
+	case FN_EXP: der = applyFunc(FN_EXP, v); break;
+	case FN_LN: der = one / v; break;
+	case FN_FLOOR: der = T(0) * v; break; //0 where v is defined
+	default: //Registered function
+		der = (getFunc(id).derivative >= 0) ? applyFunc(getFunc(id).derivative, v) : T(NAN);
+	}
+
+	return Dual<T>(applyFunc(id, v), der * a.d);
+}
+template<typename T> Dual<T> applyFunc(int id, const Dual<T> &a, const Dual<T> &b)
+{
+	switch (id)
+	{
+	case FN_MIN: return (applyFunc(id, real(a), real(b)) == real(a)) ? a : b;
+	case FN_MAX: return (applyFunc(id, real(a), real(b)) == real(a)) ? a : b;
+	case FN_ATAN2: return Dual<T>(applyFunc(id, a.v, b.v), (b.v * a.d - a.v * b.d) / (a.v * a.v + b.v * b.v)); //atan2(y, x)' = (x * y' - y * x') / (x^2 + y^2)
+	default: return Dual<T>(applyFunc(id, a.v, b.v), T(NAN));
+	}
+}
+template<typename T> bool isConstant(const T &) { return true; } //No derivative part
+template<typename T> bool isConstant(const Dual<T> &a) { return real(a.d) == 0 && isConstant(a.d); }
+template<typename T> Dual<T> pow(const Dual<T> &a, const Dual<T> &b)
+{
+	T val = pow(a.v, b.v);
+
+	if (isConstant(b)) //(u^c)' = c * u^(c - 1) * u'
+		return Dual<T>(val, b.v * pow(a.v, b.v - T(1)) * a.d);
+
+	//(u^v)' = u^v * (v' * ln(u) + v * u' / u)
+	return Dual<T>(val, val * (b.d * applyFunc(FN_LN, a.v) + b.v * a.d / a.v));
+}
+
+template<typename T> T square(const T &a) { return a * a; }
+template<typename T> T evalDiff(const Instruction*, int, const T &, const T &, int &, true_type) { return T(NAN); } //Order limit reached
+template<typename T> T evalDiff(const Instruction* code, int length, const T &x, const T &y, int &status, false_type);
+template<typename T> T evalRange(const Instruction* code, int length, const T &x, const T &y, T* nums, int &status, const T* slots = nullptr) //Run the code using nums as stack, slots holds the values of OP_SLOT
+{
+	int top = -1;
+
+	for (int i = 0; i < length; i++)
+	{
+		const Instruction &ins = code[i];
+
+		switch (ins.op)
+		{
+		case OP_NUM:
+			nums[++top] = T(ins.value);
+			break;
+		case OP_VAR_X:
+			nums[++top] = x;
+			break;
+		case OP_VAR_Y:
+			nums[++top] = y;
+			break;
+		case OP_PARAM:
+			nums[++top] = T(paramValues()[ins.arg]);
+			break;
+		case OP_SLOT: //The part values are given by the caller
+			if (!slots) error(1, "Part value out of the batch evaluator!");
+			nums[++top] = slots[ins.arg];
+			break;
+		case OP_SQUARE:
+			nums[top] = square(nums[top]);
+			break;
+		case OP_ADD:
+			top--;
+			nums[top] = nums[top] + nums[top + 1];
+			break;
+		case OP_SUB:
+			top--;
+			nums[top] = nums[top] - nums[top + 1];
+			break;
+		case OP_MUL:
+			top--;
+			nums[top] = nums[top] * nums[top + 1];
+			break;
+		case OP_DIV:
+			top--;
+			if (real(nums[top + 1]) == 0) status |= EVAL_ZERO_DIV;
+			nums[top] = nums[top] / nums[top + 1];
+			break;
+		case OP_POW:
+			top--;
+			nums[top] = pow(nums[top], nums[top + 1]);
+			break;
+		case OP_FUNC:
+			nums[top] = applyFunc(ins.arg, nums[top]);
+			break;
+		case OP_FUNC2:
+			top--;
+			nums[top] = applyFunc(ins.arg, nums[top], nums[top + 1]);
+			break;
+		case OP_DIFF:
+			//One pass of the argument with dual numbers
+			nums[++top] = evalDiff(code + i + 1, ins.arg, x, y, status, integral_constant<bool, DiffOrder<T>::value >= EXPR_MAX_DIFF>());
+			i += ins.arg;
+			break;
+		}
+	}
+
+	return nums[top];
+}
+template<typename T> T evalDiff(const Instruction* code, int length, const T &x, const T &y, int &status, false_type) //Derivative of the code in x, y is constant
+{
+	Dual<T> duals[EXPR_DIFF_STACK];
+
+	return evalRange(code, length, Dual<T>(x, T(1)), Dual<T>(y, T(0)), duals, status).d;
+}
+double evaluate(const Program &prog, double x, double y, int *status = nullptr) //Compute the program in (x, y), throws only on OP_SLOT, a part of the batch evaluator
+{
+	double nums[EXPR_MAX_STACK];
+	int flags = EVAL_OK;
+
+	double res = evalRange(prog.code.data(), prog.code.size(), x, y, nums, flags);
+	if (!isfinite(res)) flags |= EVAL_NOT_FINITE;
+	if (status) *status = flags;
+
+	return res;
+}
+double evaluate(const Program &prog, double x, int *status = nullptr) { return evaluate(prog, x, NAN, status); } //Compute the program in x
+
+/* BATCH EVALUATOR */
+#define EXPR_BATCH 256 //Lanes computed per opcode pass
+
+double* evalRangeBatch(const Instruction* code, int length, const double* xs, const double* ys, int n, double* nums, const double* slots = nullptr, int slot_count = 0) //nums holds one row of EXPR_BATCH lanes per stack slot, slot k of lane j is slots[j * slot_count + k]; returns the top row
+{
+	int rows = 0; //Rows in use
+
+	for (int i = 0; i < length; i++)
+	{
+		const Instruction &ins = code[i];
+		double *push = nums + rows * EXPR_BATCH, //Next free row
+			*a = push - 2 * EXPR_BATCH, //Binary operands
+			*b = push - EXPR_BATCH;
+
+		switch (ins.op)
+		{
+		case OP_NUM:
+			for (int j = 0; j < n; j++) push[j] = ins.value;
+			rows++;
+			break;
+		case OP_VAR_X:
+			for (int j = 0; j < n; j++) push[j] = xs[j];
+			rows++;
+			break;
+		case OP_VAR_Y:
+			for (int j = 0; j < n; j++) push[j] = ys ? ys[j] : NAN;
+			rows++;
+			break;
+		case OP_PARAM:
+		{
+			double value = paramValues()[ins.arg];
+			for (int j = 0; j < n; j++) push[j] = value;
+			rows++;
+			break;
+		}
+		case OP_SLOT:
+			for (int j = 0; j < n; j++) push[j] = slots[j * slot_count + ins.arg];
+			rows++;
+			break;
+		case OP_SQUARE:
+			for (int j = 0; j < n; j++) b[j] = b[j] * b[j];
+			break;
+		case OP_ADD:
+			for (int j = 0; j < n; j++) a[j] = a[j] + b[j];
+			rows--;
+			break;
+		case OP_SUB:
+			for (int j = 0; j < n; j++) a[j] = a[j] - b[j];
+			rows--;
+			break;
+		case OP_MUL:
+			for (int j = 0; j < n; j++) a[j] = a[j] * b[j];
+			rows--;
+			break;
+		case OP_DIV:
+			for (int j = 0; j < n; j++) a[j] = a[j] / b[j];
+			rows--;
+			break;
+		case OP_POW:
+			for (int j = 0; j < n; j++) a[j] = pow(a[j], b[j]);
+			rows--;
+			break;
+		case OP_FUNC:
+		{
+			UnaryFunc func = getFunc(ins.arg).unary;
+			for (int j = 0; j < n; j++) b[j] = func(b[j]);
+			break;
+		}
+		case OP_FUNC2:
+		{
+			BinaryFunc func = getFunc(ins.arg).binary;
+			for (int j = 0; j < n; j++) a[j] = func(a[j], b[j]);
+			rows--;
+			break;
+		}
+		case OP_DIFF:
+		{
+			//One dual pass of the argument per lane
+			int status = EVAL_OK;
+			for (int j = 0; j < n; j++) push[j] = evalDiff(code + i + 1, ins.arg, xs[j], ys ? ys[j] : NAN, status, false_type());
+			rows++;
+			i += ins.arg;
+			break;
+		}
+		}
+	}
+
+	return nums + (rows - 1) * EXPR_BATCH;
+}
+void evaluate(const Program &prog, const double* xs, const double* ys, double* fs, size_t n) //Compute the program for every (x, y), impossible values are NaN or infinite
+{
+	vector<double> nums((size_t)prog.max_depth * EXPR_BATCH);
+
+	for (size_t begin = 0; begin < n; begin += EXPR_BATCH)
+	{
+		int lanes = (int)min((size_t)EXPR_BATCH, n - begin);
+
+		double *res = evalRangeBatch(prog.code.data(), prog.code.size(), xs + begin, ys ? ys + begin : nullptr, lanes, nums.data());
+		copy(res, res + lanes, fs + begin);
+	}
+}
+void evaluate(const Program &prog, const double* xs, double* ys, size_t n) { evaluate(prog, xs, nullptr, ys, n); } //Compute the program for every x
+void evaluate(const Program &prog, const double* xs, const double* slots, int slot_count, double* ys, size_t n) //Compute a program with OP_SLOT for every x, the slots of x i are slots[i * slot_count, (i + 1) * slot_count)
+{
+	vector<double> nums((size_t)prog.max_depth * EXPR_BATCH);
+
+	for (size_t begin = 0; begin < n; begin += EXPR_BATCH)
+	{
+		int lanes = (int)min((size_t)EXPR_BATCH, n - begin);
+
+		double *res = evalRangeBatch(prog.code.data(), prog.code.size(), xs + begin, nullptr, lanes, nums.data(), slots + begin * slot_count, slot_count);
+		copy(res, res + lanes, ys + begin);
+	}
+}
+
+/* INTERVAL EVALUATOR */
+struct Interval //Enclosure of the values of a function over a range of x
+{
+	double lo, hi; //Empty (never defined) when lo > hi
+	bool cont; //Defined and continuous on the whole range
+
+	Interval() = default; //Left unset like a double, the evaluation stacks are not cleared at every call
+	Interval(double c) : lo(isnan(c) ? INFINITY : c), hi(isnan(c) ? -INFINITY : c), cont(isfinite(c)) {}
+	Interval(double lo, double hi, bool cont = true) : lo(lo), hi(hi), cont(cont) {}
+};
+
+bool isEmpty(const Interval &a) { return !(a.lo <= a.hi); }
+Interval emptyInterval() { return Interval(INFINITY, -INFINITY, false); }
+Interval entireInterval() { return Interval(-INFINITY, INFINITY, false); }
+Interval enclose(double lo, double hi, bool cont) //Rounded outward, NaN bounds become infinite
+{
+	if (isnan(lo)) lo = -INFINITY;
+	if (isnan(hi)) hi = INFINITY;
+	if (!isfinite(lo) || !isfinite(hi)) cont = false;
+
+	return Interval(nextafter(lo, -INFINITY), nextafter(hi, INFINITY), cont);
+}
+double real(const Interval &a) { return (a.lo <= 0 && a.hi >= 0) ? 0 : a.lo; } //Zero if it may be zero
+
+Interval operator+(const Interval &a, const Interval &b)
+{
+	if (isEmpty(a) || isEmpty(b)) return emptyInterval();
+	return enclose(a.lo + b.lo, a.hi + b.hi, a.cont && b.cont);
+}
+Interval operator-(const Interval &a, const Interval &b)
+{
+	if (isEmpty(a) || isEmpty(b)) return emptyInterval();
+	return enclose(a.lo - b.hi, a.hi - b.lo, a.cont && b.cont);
+}
+double mulBound(double a, double b) { return (a == 0 || b == 0) ? 0 : a * b; } //0 * inf is a bound of 0
+Interval operator*(const Interval &a, const Interval &b)
+{
+	if (isEmpty(a) || isEmpty(b)) return emptyInterval();
+
+	double p[] = { mulBound(a.lo, b.lo), mulBound(a.lo, b.hi), mulBound(a.hi, b.lo), mulBound(a.hi, b.hi) };
+	return enclose(*min_element(p, p + 4), *max_element(p, p + 4), a.cont && b.cont);
+}
+Interval operator/(const Interval &a, const Interval &b)
+{
+	if (isEmpty(a) || isEmpty(b) || (b.lo == 0 && b.hi == 0)) return emptyInterval();
+	if (b.lo <= 0 && b.hi >= 0) return entireInterval(); //Pole
+
+	double q[] = { a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi };
+	return enclose(*min_element(q, q + 4), *max_element(q, q + 4), a.cont && b.cont);
+}
+
+Interval applyMonotone(double(*f)(double), const Interval &a, double dom_lo, double dom_hi, bool increasing = true) //f monotone on [dom_lo, dom_hi], NaN outside
+{
+	if (isEmpty(a) || a.hi < dom_lo || a.lo > dom_hi) return emptyInterval();
+
+	bool cont = a.cont && a.lo >= dom_lo && a.hi <= dom_hi;
+	double lo = f(max(a.lo, dom_lo)),
+		hi = f(min(a.hi, dom_hi));
+	return increasing ? enclose(lo, hi, cont) : enclose(hi, lo, cont);
+}
+bool hasPeriodPoint(const Interval &a, double point, double period) //Whether point + k * period is in a, may say yes on a near miss
+{
+	double k = ceil((a.lo - point) / period),
+		eps = 1e-12 * (1 + abs(a.lo) + abs(a.hi));
+	return point + k * period <= a.hi + eps || point + (k - 1) * period >= a.lo - eps;
+}
+Interval applyFunc(int id, const Interval &a)
+{
+	const double pi = acos(-1.0);
+	if (isEmpty(a)) return emptyInterval();
+
+	switch (id)
+	{
+	case FN_ABS:
+		if (a.lo >= 0) return a;
+		if (a.hi <= 0) return Interval(-a.hi, -a.lo, a.cont);
+		return Interval(0, max(-a.lo, a.hi), a.cont);
+	case FN_COSH:
+		if (a.lo >= 0) return applyMonotone(cosh, a, 0, INFINITY);
+		if (a.hi <= 0) return applyMonotone(cosh, a, -INFINITY, 0, false);
+		return enclose(1, cosh(max(-a.lo, a.hi)), a.cont);
+	case FN_SIN:
+	case FN_COS:
+	{
+		if (!isfinite(a.lo) || !isfinite(a.hi) || a.hi - a.lo >= 2 * pi || abs(a.lo) > 1e9 || abs(a.hi) > 1e9) return Interval(-1, 1, a.cont && isfinite(a.lo) && isfinite(a.hi));
+
+		//Extremes at the ends, or at the peaks inside
+		double top = (id == FN_SIN) ? pi / 2 : 0,
+			f_lo = applyFunc(id, a.lo),
+			f_hi = applyFunc(id, a.hi);
+		double lo = hasPeriodPoint(a, top + pi, 2 * pi) ? -1 : min(f_lo, f_hi),
+			hi = hasPeriodPoint(a, top, 2 * pi) ? 1 : max(f_lo, f_hi);
+		Interval res = enclose(lo, hi, a.cont);
+		return Interval(max(res.lo, -1.0), min(res.hi, 1.0), res.cont);
+	}
+	case FN_TAN:
+		if (!isfinite(a.lo) || !isfinite(a.hi) || a.hi - a.lo >= pi || abs(a.lo) > 1e9 || abs(a.hi) > 1e9 || hasPeriodPoint(a, pi / 2, pi)) return entireInterval();
+		return applyMonotone(tan, a, -INFINITY, INFINITY);
+	case FN_ACOS: return applyMonotone(acos, a, -1, 1, false);
+	case FN_ASIN: return applyMonotone(asin, a, -1, 1);
+	case FN_ATAN: return applyMonotone(atan, a, -INFINITY, INFINITY);
+	case FN_SINH: return applyMonotone(sinh, a, -INFINITY, INFINITY);
+	case FN_TANH: return applyMonotone(tanh, a, -INFINITY, INFINITY);
+	case FN_ACOSH: return applyMonotone(acosh, a, 1, INFINITY);
+	case FN_ASINH: return applyMonotone(asinh, a, -INFINITY, INFINITY);
+	case FN_ATANH: return applyMonotone(atanh, a, -1, 1);
+	case FN_SQRT: return applyMonotone(sqrt, a, 0, INFINITY);
+	case FN_CBRT: return applyMonotone(cbrt, a, -INFINITY, INFINITY);
+	case FN_EXP: return applyMonotone(exp, a, -INFINITY, INFINITY);
+	case FN_LN: return applyMonotone(log, a, 0, INFINITY);
+	case FN_FLOOR:
+	{
+		Interval res = applyMonotone(floor, a, -INFINITY, INFINITY);
+		res.cont = res.cont && floor(a.lo) == floor(a.hi); //Steps at the integers
+		return res;
+	}
+	default: //Registered function: nothing known
+		return entireInterval();
+	}
+}
+Interval applyFunc(int id, const Interval &a, const Interval &b)
+{
+	const double pi = acos(-1.0);
+	if (id == FN_MIN || id == FN_MAX)
+	{
+		//fmin and fmax give the defined operand where the other one is NaN
+		if (isEmpty(a)) return Interval(b.lo, b.hi, false);
+		if (isEmpty(b)) return Interval(a.lo, a.hi, false);
+
+		Interval res = (id == FN_MIN) ? Interval(min(a.lo, b.lo), min(a.hi, b.hi), a.cont && b.cont) : Interval(max(a.lo, b.lo), max(a.hi, b.hi), a.cont && b.cont);
+		if (!a.cont) res = Interval(min(res.lo, b.lo), max(res.hi, b.hi), false); //a may be NaN somewhere
+		if (!b.cont) res = Interval(min(res.lo, a.lo), max(res.hi, a.hi), false);
+		return res;
+	}
+	if (isEmpty(a) || isEmpty(b)) return emptyInterval();
+
+	switch (id)
+	{
+	case FN_ATAN2: //atan2(y, x), cut along the negative x axis
+		if (b.lo > 0) return applyFunc(FN_ATAN, a / b);
+		if (a.lo > 0) return Interval(pi / 2, pi / 2) - applyFunc(FN_ATAN, b / a);
+		if (a.hi < 0) return Interval(-pi / 2, -pi / 2) - applyFunc(FN_ATAN, b / a);
+		return enclose(-pi, pi, false);
+	default:
+		return entireInterval();
+	}
+}
+Interval pow(const Interval &a, const Interval &b)
+{
+	if (isEmpty(a) || isEmpty(b)) return emptyInterval();
+
+	if (b.lo == b.hi && b.lo == floor(b.lo) && abs(b.lo) < 1e9)
+	{
+		//Integer power
+		double n = b.lo;
+		if (n == 0) return Interval(1);
+		if (n < 0) return Interval(1) / pow(a, Interval(-n));
+
+		bool even = fmod(n, 2) == 0;
+		if (!even || a.lo >= 0) return enclose(pow(a.lo, n), pow(a.hi, n), a.cont);
+		if (a.hi <= 0) return enclose(pow(a.hi, n), pow(a.lo, n), a.cont);
+		return enclose(0, pow(max(-a.lo, a.hi), n), a.cont);
+	}
+
+	//Negative bases have values only at some exponents
+	if (a.lo < 0 && b.lo != b.hi) return entireInterval();
+	if (a.hi < 0) return emptyInterval();
+
+	Interval base(max(a.lo, 0.0), a.hi, a.cont && a.lo >= 0);
+	return applyFunc(FN_EXP, b * applyFunc(FN_LN, base));
+}
+Interval square(const Interval &a) //Never negative, a * a is not as tight
+{
+	Interval res = pow(a, Interval(2));
+	return isEmpty(res) ? res : Interval(max(res.lo, 0.0), res.hi, res.cont);
+}
+Interval evalDiff(const Instruction*, int, const Interval &, const Interval &, int &, false_type) { return entireInterval(); } //Derivatives are not enclosed
+
+Interval evaluate(const Program &prog, const Interval &x, const Interval &y) //Enclosure of the program over the box x * y, throws only on OP_SLOT
+{
+	Interval nums[EXPR_MAX_STACK];
+	int flags = EVAL_OK;
+
+	return evalRange(prog.code.data(), prog.code.size(), x, y, nums, flags);
+}
+Interval evaluate(const Program &prog, const Interval &x) { return evaluate(prog, x, emptyInterval()); } //Enclosure of the program over x
+Interval evaluate(const Program &prog, const Interval &x, const Interval* slots) //Enclosure of a program with OP_SLOT over x, slot k is enclosed by slots[k]
+{
+	Interval nums[EXPR_MAX_STACK];
+	int flags = EVAL_OK;
+
+	return evalRange(prog.code.data(), prog.code.size(), x, emptyInterval(), nums, flags, slots);
+}
+
+/* OPTIMIZER */
+struct Segment //Instructions computing one stack value
+{
+	unsigned int start;
+	bool is_const;
+	double value;
+	int peak; //Stack depth reached while computing it
+};
+double applyOp(int op, double a, double b) //Same arithmetic of the evaluators
+{
+	switch (op)
+	{
+	case OP_ADD: return a + b;
+	case OP_SUB: return a - b;
+	case OP_MUL: return a * b;
+	case OP_DIV: return a / b;
+	case OP_POW: return pow(a, b);
+	}
+	return NAN;
+}
+int optimizeRange(const Instruction* code, int length, vector<Instruction> &out, vector<Segment> &segs) //Returns the peak depth
+{
+	int peak = 0;
+
+	for (int i = 0; i < length; i++)
+	{
+		Instruction ins = code[i];
+		int depth = segs.size();
+
+		switch (ins.op)
+		{
+		case OP_NUM:
+		case OP_VAR_X:
+		case OP_VAR_Y:
+		case OP_PARAM:
+		case OP_SLOT:
+			segs.push_back({ (unsigned int)out.size(), ins.op == OP_NUM, ins.value, depth + 1 });
+			out.push_back(ins);
+			break;
+		case OP_FUNC:
+		{
+			Segment &arg = segs.back();
+
+			if (arg.is_const)
+			{
+				//f(c) is computed now
+				arg.value = applyFunc(ins.arg, arg.value);
+				out[arg.start].value = arg.value;
+			}
+			else
+				out.push_back(ins);
+			break;
+		}
+		case OP_SQUARE:
+		{
+			Segment &arg = segs.back();
+
+			if (arg.is_const)
+			{
+				//c^2 is computed now
+				arg.value = arg.value * arg.value;
+				out[arg.start].value = arg.value;
+			}
+			else
+				out.push_back(ins);
+			break;
+		}
+		case OP_FUNC2:
+		{
+			Segment b = segs.back();
+			segs.pop_back();
+			Segment &a = segs.back();
+			a.peak = max(a.peak, b.peak);
+
+			if (a.is_const && b.is_const)
+			{
+				//f(c, d) is computed now
+				a.value = applyFunc(ins.arg, a.value, b.value);
+				out.pop_back();
+				out[a.start].value = a.value;
+			}
+			else
+			{
+				a.is_const = false;
+				out.push_back(ins);
+			}
+			break;
+		}
+		case OP_DIFF:
+		{
+			//The argument has its own stack
+			vector<Instruction> arg_code;
+			vector<Segment> arg_segs;
+			optimizeRange(code + i + 1, ins.arg, arg_code, arg_segs);
+			i += ins.arg;
+
+			if (arg_segs.back().is_const)
+			{
+				//Derivative of a constant, NaN if it is nowhere defined
+				ins.op = OP_NUM;
+				ins.value = isfinite(arg_segs.back().value) ? 0 : NAN;
+				segs.push_back({ (unsigned int)out.size(), true, ins.value, depth + 1 });
+				out.push_back(ins);
+			}
+			else
+			{
+				ins.arg = arg_code.size();
+				segs.push_back({ (unsigned int)out.size(), false, 0, depth + 1 });
+				out.push_back(ins);
+				out.insert(out.end(), arg_code.begin(), arg_code.end());
 			}
+			break;
 		}
+		default: //Binary operators
+		{
+			Segment b = segs.back();
+			segs.pop_back();
+			Segment &a = segs.back();
+			a.peak = max(a.peak, b.peak);
+
+			if (a.is_const && b.is_const)
+			{
+				//Both constant
+				a.value = applyOp(ins.op, a.value, b.value);
+				out.pop_back();
+				out[a.start].value = a.value;
+			}
+			else if (b.is_const && ((b.value == 0 && (ins.op == OP_ADD || ins.op == OP_SUB)) || (b.value == 1 && (ins.op == OP_MUL || ins.op == OP_DIV || ins.op == OP_POW))))
+			{
+				//x+0, x-0, x*1, x/1, x^1 (the sign of a zero x may change, never the plot)
+				out.pop_back();
+			}
+			else if (a.is_const && ((a.value == 0 && ins.op == OP_ADD) || (a.value == 1 && ins.op == OP_MUL)))
+			{
+				//0+x, 1*x
+				out.erase(out.begin() + a.start);
+				a = b;
+				a.start--;
+			}
+			else if ((b.is_const && b.value == 0 && ins.op == OP_POW) || (a.is_const && a.value == 1 && ins.op == OP_POW))
+			{
+				//x^0, 1^x
+				out.erase(out.begin() + a.start, out.end());
+				a = { a.start, true, 1, depth - 1 };
+				out.push_back(Instruction());
+				out.back().op = OP_NUM;
+				out.back().value = 1;
+			}
+			else if (b.is_const && b.value == 2 && ins.op == OP_POW)
+			{
+				//x^2, without pow
+				a.is_const = false;
+				out.back() = Instruction();
+				out.back().op = OP_SQUARE;
+			}
+			else
+			{
+				a.is_const = false;
+				out.push_back(ins);
+			}
+			break;
+		}
+		}
+
+		if (segs.size() > 0) peak = max(peak, segs.back().peak);
 	}
 
-	return nums.top();
-}
\ No newline at end of file
+	return peak;
+}
+void optimizeProgram(Program &prog) //Fold constant subexpressions and apply safe identities
+{
+	vector<Instruction> out;
+	vector<Segment> segs;
+
+	prog.max_depth = optimizeRange(prog.code.data(), prog.code.size(), out, segs);
+	prog.code = out;
+}
+
+/* EXPRESSION TREE */
+struct Node;
+typedef shared_ptr<const Node> NodePtr;
+struct Node
+{
+	OPCODE op; //OP_NUM, OP_VAR_X, OP_VAR_Y, OP_PARAM, OP_SLOT, binary operators, OP_FUNC, OP_FUNC2 or OP_DIFF
+	double value = 0; //OP_NUM: constant
+	int func = 0; //OP_FUNC/OP_FUNC2: function id, OP_PARAM/OP_SLOT: index
+	NodePtr a, b; //Operands, a only for unary functions and diff
+};
+
+NodePtr mkNum(double value)
+{
+	Node n;
+	n.op = OP_NUM;
+	n.value = value;
+	return make_shared<const Node>(n);
+}
+NodePtr mkX()
+{
+	Node n;
+	n.op = OP_VAR_X;
+	return make_shared<const Node>(n);
+}
+NodePtr mkY()
+{
+	Node n;
+	n.op = OP_VAR_Y;
+	return make_shared<const Node>(n);
+}
+NodePtr mkParam(OPCODE op, int index) //OP_PARAM or OP_SLOT
+{
+	Node n;
+	n.op = op;
+	n.func = index;
+	return make_shared<const Node>(n);
+}
+bool isNum(const NodePtr &n, double value) { return n->op == OP_NUM && n->value == value; }
+bool isNeg(const NodePtr &n) { return n->op == OP_SUB && isNum(n->a, 0); } //0-u
+bool sameNode(const NodePtr &a, const NodePtr &b) //Same expression
+{
+	if (a == b) return true;
+	if (!a || !b || a->op != b->op || a->value != b->value || a->func != b->func) return false;
+	return sameNode(a->a, b->a) && sameNode(a->b, b->b);
+}
+bool isTotal(const NodePtr &n) //Defined for every x and y, so 0*n and n-n are always 0 (overflow aside)
+{
+	switch (n->op)
+	{
+	case OP_NUM: return isfinite(n->value);
+	case OP_VAR_X: case OP_VAR_Y: case OP_PARAM: return true;
+	case OP_ADD: case OP_SUB: case OP_MUL: return isTotal(n->a) && isTotal(n->b);
+	case OP_POW: return isTotal(n->a) && n->b->op == OP_NUM && n->b->value >= 0 && n->b->value == floor(n->b->value); //u^n, n natural
+	case OP_FUNC:
+		switch (n->func)
+		{
+		case FN_ABS: case FN_COS: case FN_SIN: case FN_ATAN: case FN_TANH: case FN_FLOOR: return isTotal(n->a);
+		default: return false;
+		}
+	case OP_FUNC2: return n->func == FN_MIN || n->func == FN_MAX ? isTotal(n->a) && isTotal(n->b) : false;
+	default: return false;
+	}
+}
+NodePtr mkNode(OPCODE op, const NodePtr &a, const NodePtr &b = nullptr, int func = 0)
+{
+	Node n;
+	n.op = op;
+	n.a = a;
+	n.b = b;
+	n.func = func;
+	return make_shared<const Node>(n);
+}
+//Builders with simplification
+NodePtr mkFunc(int func, const NodePtr &a)
+{
+	if (a->op == OP_NUM) return mkNum(applyFunc(func, a->value));
+	return mkNode(OP_FUNC, a, nullptr, func);
+}
+NodePtr mkFunc(int func, const NodePtr &a, const NodePtr &b)
+{
+	if (a->op == OP_NUM && b->op == OP_NUM) return mkNum(applyFunc(func, a->value, b->value));
+	return mkNode(OP_FUNC2, a, b, func);
+}
+NodePtr mkBinary(OPCODE op, const NodePtr &a, const NodePtr &b)
+{
+	if (a->op == OP_NUM && b->op == OP_NUM) return mkNum(applyOp(op, a->value, b->value));
+
+	switch (op)
+	{
+	case OP_ADD:
+		if (isNum(a, 0)) return b;
+		if (isNum(b, 0)) return a;
+		if (isNeg(b)) return mkBinary(OP_SUB, a, b->b); //a+(-b)
+		if (sameNode(a, b)) return mkBinary(OP_MUL, mkNum(2), a);
+		break;
+	case OP_SUB:
+		if (isNum(b, 0)) return a;
+		if (isNeg(b)) return mkBinary(OP_ADD, a, b->b); //a-(-b)
+		if (sameNode(a, b) && isTotal(a)) return mkNum(0);
+		break;
+	case OP_MUL:
+		if ((isNum(a, 0) && isTotal(b)) || (isNum(b, 0) && isTotal(a))) return mkNum(0);
+		if (isNum(a, 1)) return b;
+		if (isNum(b, 1)) return a;
+		if (b->op == OP_NUM && a->op != OP_NUM) return mkBinary(OP_MUL, b, a); //Constants first
+		if (a->op == OP_NUM && a->value < 0) return mkBinary(OP_SUB, mkNum(0), mkBinary(OP_MUL, mkNum(-a->value), b));
+		if (isNeg(a)) return mkBinary(OP_SUB, mkNum(0), mkBinary(OP_MUL, a->b, b));
+		if (isNeg(b)) return mkBinary(OP_SUB, mkNum(0), mkBinary(OP_MUL, a, b->b));
+		if (a->op == OP_NUM && b->op == OP_MUL && b->a->op == OP_NUM) return mkBinary(OP_MUL, mkNum(a->value * b->a->value), b->b); //c*(d*u)
+		if (a->op == OP_DIV && isNum(a->a, 1)) return mkBinary(OP_DIV, b, a->b); //(1/u)*v
+		if (b->op == OP_DIV && isNum(b->a, 1)) return mkBinary(OP_DIV, a, b->b); //u*(1/v)
+		break;
+	case OP_DIV: //0/u and u/u are NaN where u is 0
+		if (isNum(b, 1)) return a;
+		if (isNeg(a)) return mkBinary(OP_SUB, mkNum(0), mkBinary(OP_DIV, a->b, b));
+		if (a->op == OP_NUM && a->value < 0) return mkBinary(OP_SUB, mkNum(0), mkBinary(OP_DIV, mkNum(-a->value), b));
+		break;
+	case OP_POW:
+		if (isNum(b, 0)) return mkNum(1);
+		if (isNum(b, 1)) return a;
+		break;
+	default:
+		break;
+	}
+
+	return mkNode(op, a, b);
+}
+NodePtr mkNeg(const NodePtr &a) { return mkBinary(OP_SUB, mkNum(0), a); }
+
+int buildRange(const Instruction* code, int length, vector<NodePtr> &nodes) //Rebuild the tree of the code, returns the code used
+{
+	int i;
+	for (i = 0; i < length; i++)
+	{
+		const Instruction &ins = code[i];
+
+		switch (ins.op)
+		{
+		case OP_NUM:
+			nodes.push_back(mkNum(ins.value));
+			break;
+		case OP_VAR_X:
+			nodes.push_back(mkX());
+			break;
+		case OP_VAR_Y:
+			nodes.push_back(mkY());
+			break;
+		case OP_PARAM:
+		case OP_SLOT:
+			nodes.push_back(mkParam(ins.op, ins.arg));
+			break;
+		case OP_SQUARE:
+			nodes.back() = mkNode(OP_POW, nodes.back(), mkNum(2));
+			break;
+		case OP_FUNC:
+			nodes.back() = mkNode(OP_FUNC, nodes.back(), nullptr, ins.arg);
+			break;
+		case OP_FUNC2:
+		{
+			NodePtr b = nodes.back();
+			nodes.pop_back();
+			nodes.back() = mkNode(OP_FUNC2, nodes.back(), b, ins.arg);
+			break;
+		}
+		case OP_DIFF:
+		{
+			vector<NodePtr> arg;
+			buildRange(code + i + 1, ins.arg, arg);
+			nodes.push_back(mkNode(OP_DIFF, arg.back()));
+			i += ins.arg;
+			break;
+		}
+		default:
+		{
+			NodePtr b = nodes.back();
+			nodes.pop_back();
+			nodes.back() = mkNode(ins.op, nodes.back(), b);
+			break;
+		}
+		}
+	}
+
+	return i;
+}
+NodePtr buildTree(const Program &prog) //Expression tree of a compiled program
+{
+	vector<NodePtr> nodes;
+	buildRange(prog.code.data(), prog.code.size(), nodes);
+
+	return nodes.back();
+}
+
+/* SYMBOLIC DIFFERENTIATION */
+bool hasX(const NodePtr &n)
+{
+	if (n->op == OP_VAR_X) return true;
+	return (n->a && hasX(n->a)) || (n->b && hasX(n->b));
+}
+bool hasParam(const NodePtr &n)
+{
+	if (n->op == OP_PARAM) return true;
+	return (n->a && hasParam(n->a)) || (n->b && hasParam(n->b));
+}
+NodePtr differentiate(const NodePtr &n) //d/dx of a tree without diff nodes
+{
+	const NodePtr &u = n->a, &v = n->b;
+
+	switch (n->op)
+	{
+	case OP_NUM: return mkNum(isfinite(n->value) ? 0 : NAN); //Nowhere defined stays so
+	case OP_VAR_X: return mkNum(1);
+	case OP_VAR_Y: return mkNum(0); //Partial derivative
+	case OP_PARAM: return mkNum(0);
+	case OP_ADD: return mkBinary(OP_ADD, differentiate(u), differentiate(v));
+	case OP_SUB: return mkBinary(OP_SUB, differentiate(u), differentiate(v));
+	case OP_MUL: //u'v + uv', the term of a constant factor is 0 where the other one is defined
+		if (!hasX(u) && isTotal(v)) return mkBinary(OP_MUL, u, differentiate(v));
+		if (!hasX(v) && isTotal(u)) return mkBinary(OP_MUL, differentiate(u), v);
+		return mkBinary(OP_ADD, mkBinary(OP_MUL, differentiate(u), v), mkBinary(OP_MUL, u, differentiate(v)));
+	case OP_DIV: //(u'v - uv') / v^2
+		return mkBinary(OP_DIV, mkBinary(OP_SUB, mkBinary(OP_MUL, differentiate(u), v), mkBinary(OP_MUL, u, differentiate(v))), mkBinary(OP_POW, v, mkNum(2)));
+	case OP_POW:
+		if (!hasX(v)) //c * u^(c - 1) * u'
+			return mkBinary(OP_MUL, mkBinary(OP_MUL, v, mkBinary(OP_POW, u, mkBinary(OP_SUB, v, mkNum(1)))), differentiate(u));
+		if (!hasX(u)) //u^v * ln(u) * v'
+			return mkBinary(OP_MUL, mkBinary(OP_MUL, n, mkFunc(FN_LN, u)), differentiate(v));
+		//u^v * (v' * ln(u) + v * u' / u)
+		return mkBinary(OP_MUL, n, mkBinary(OP_ADD, mkBinary(OP_MUL, differentiate(v), mkFunc(FN_LN, u)), mkBinary(OP_DIV, mkBinary(OP_MUL, v, differentiate(u)), u)));
+	case OP_FUNC:
+	{
+		NodePtr one = mkNum(1), der; //f'(u)
+		switch (n->func)
+		{
+		case FN_ABS: der = mkBinary(OP_DIV, u, n); break;
+		case FN_COS: der = mkNeg(mkFunc(FN_SIN, u)); break;
+		case FN_SIN: der = mkFunc(FN_COS, u); break;
+		case FN_TAN: der = mkBinary(OP_DIV, one, mkBinary(OP_POW, mkFunc(FN_COS, u), mkNum(2))); break;
+		case FN_ACOS: der = mkNeg(mkBinary(OP_DIV, one, mkFunc(FN_SQRT, mkBinary(OP_SUB, one, mkBinary(OP_POW, u, mkNum(2)))))); break;
+		case FN_ASIN: der = mkBinary(OP_DIV, one, mkFunc(FN_SQRT, mkBinary(OP_SUB, one, mkBinary(OP_POW, u, mkNum(2))))); break;
+		case FN_ATAN: der = mkBinary(OP_DIV, one, mkBinary(OP_ADD, one, mkBinary(OP_POW, u, mkNum(2)))); break;
+		case FN_COSH: der = mkFunc(FN_SINH, u); break;
+		case FN_SINH: der = mkFunc(FN_COSH, u); break;
+		case FN_TANH: der = mkBinary(OP_DIV, one, mkBinary(OP_POW, mkFunc(FN_COSH, u), mkNum(2))); break;
+		case FN_ACOSH: der = mkBinary(OP_DIV, one, mkFunc(FN_SQRT, mkBinary(OP_SUB, mkBinary(OP_POW, u, mkNum(2)), one))); break;
+		case FN_ASINH: der = mkBinary(OP_DIV, one, mkFunc(FN_SQRT, mkBinary(OP_ADD, mkBinary(OP_POW, u, mkNum(2)), one))); break;
+		case FN_ATANH: der = mkBinary(OP_DIV, one, mkBinary(OP_SUB, one, mkBinary(OP_POW, u, mkNum(2)))); break;
+		case FN_SQRT: der = mkBinary(OP_DIV, one, mkBinary(OP_MUL, mkNum(2), n)); break;
+		case FN_CBRT: der = mkBinary(OP_DIV, one, mkBinary(OP_MUL, mkNum(3), mkBinary(OP_POW, n, mkNum(2)))); break;
+		case FN_EXP: der = n; break;
+		case FN_LN: der = mkBinary(OP_DIV, one, u); break;
+		case FN_FLOOR: der = mkBinary(OP_MUL, mkNum(0), u); break; //0 where u is defined
+		default: //Registered function
+			if (getFunc(n->func).derivative < 0) error(0, "Unknown derivative!");
+			der = mkFunc(getFunc(n->func).derivative, u);
+		}
+		return mkBinary(OP_MUL, der, differentiate(u));
+	}
+	case OP_FUNC2:
+		if (n->func != FN_ATAN2) error(0, "Unknown derivative!"); //min and max are left to the dual numbers
+		//atan2(u, v)' = (v * u' - u * v') / (u^2 + v^2)
+		return mkBinary(OP_DIV, mkBinary(OP_SUB, mkBinary(OP_MUL, v, differentiate(u)), mkBinary(OP_MUL, u, differentiate(v))),
+			mkBinary(OP_ADD, mkBinary(OP_POW, u, mkNum(2)), mkBinary(OP_POW, v, mkNum(2))));
+	default:
+		error(0, "Syntax error!");
+	}
+	return nullptr;
+}
+NodePtr expandDiff(const NodePtr &n) //Replace every diff node with its symbolic derivative
+{
+	switch (n->op)
+	{
+	case OP_NUM:
+	case OP_VAR_X:
+	case OP_VAR_Y:
+	case OP_PARAM:
+		return n;
+	case OP_FUNC:
+		return mkFunc(n->func, expandDiff(n->a));
+	case OP_FUNC2:
+		return mkFunc(n->func, expandDiff(n->a), expandDiff(n->b));
+	case OP_DIFF:
+		return differentiate(expandDiff(n->a));
+	default:
+		return mkBinary(n->op, expandDiff(n->a), expandDiff(n->b));
+	}
+}
+
+/* TREE OUTPUT */
+int nodePrec(const NodePtr &n) //Infix precedence
+{
+	switch (n->op)
+	{
+	case OP_ADD: case OP_SUB: return 1;
+	case OP_MUL: case OP_DIV: return 2;
+	case OP_POW: return 3;
+	case OP_NUM: return (n->value < 0) ? 0 : 4;
+	default: return 4;
+	}
+}
+string toInfix(const NodePtr &n, bool child = false) //Readable formula of the tree
+{
+	static const char symbols[] = { 0, 0, '+', '-', '*', '/', '^' };
+
+	switch (n->op)
+	{
+	case OP_NUM:
+	{
+		if (n->value == E) return "e";
+		if (n->value == PI) return "p";
+		//10 significant digits in fixed notation, parseInfix reads no exponents
+		ostringstream num;
+		if (isfinite(n->value) && n->value != 0) num << fixed << setprecision(max(0, 9 - (int)floor(log10(abs(n->value)))));
+		num << n->value;
+		string str = num.str();
+		if (str.find('.') != string::npos)
+		{
+			str.erase(str.find_last_not_of('0') + 1);
+			if (str.back() == '.') str.pop_back();
+		}
+		return (child && n->value < 0) ? "(" + str + ")" : str;
+	}
+	case OP_VAR_X:
+		return "x";
+	case OP_VAR_Y:
+		return "y";
+	case OP_PARAM:
+		return string(1, 'a' + n->func);
+	case OP_FUNC:
+		return getFunc(n->func).name + "(" + toInfix(n->a) + ")";
+	case OP_FUNC2:
+		return getFunc(n->func).name + "(" + toInfix(n->a) + "," + toInfix(n->b) + ")";
+	case OP_DIFF:
+		return "diff(" + toInfix(n->a) + ")";
+	default:
+	{
+		if (isNeg(n)) //Leading minus, parenthesized inside other operators
+		{
+			string res = "-" + ((nodePrec(n->b) <= 1) ? "(" + toInfix(n->b) + ")" : toInfix(n->b, true));
+			return child ? "(" + res + ")" : res;
+		}
+
+		int prec = nodePrec(n);
+		bool par_a = nodePrec(n->a) < prec || (n->op == OP_POW && nodePrec(n->a) == prec),
+			par_b = nodePrec(n->b) < prec || (n->op != OP_ADD && n->op != OP_MUL && nodePrec(n->b) == prec);
+
+		string a = par_a ? "(" + toInfix(n->a) + ")" : toInfix(n->a, true),
+			b = par_b ? "(" + toInfix(n->b) + ")" : toInfix(n->b, true);
+		return a + symbols[n->op] + b;
+	}
+	}
+}
+int compileNode(const NodePtr &n, Program &prog, int depth) //Append the bytecode of the tree, returns the peak depth
+{
+	Instruction ins;
+	ins.op = n->op;
+
+	switch (n->op)
+	{
+	case OP_PARAM:
+	case OP_SLOT:
+		ins.arg = n->func;
+		prog.code.push_back(ins);
+		return depth + 1;
+	case OP_NUM:
+		ins.value = n->value;
+		prog.code.push_back(ins);
+		return depth + 1;
+	case OP_VAR_X:
+	case OP_VAR_Y:
+		prog.code.push_back(ins);
+		return depth + 1;
+	case OP_FUNC:
+	{
+		int peak = compileNode(n->a, prog, depth);
+		ins.arg = n->func;
+		prog.code.push_back(ins);
+		return peak;
+	}
+	case OP_FUNC2:
+	{
+		int peak = compileNode(n->a, prog, depth);
+		peak = max(peak, compileNode(n->b, prog, depth + 1));
+		ins.arg = n->func;
+		prog.code.push_back(ins);
+		return peak;
+	}
+	case OP_DIFF:
+	{
+		unsigned int pos = prog.code.size();
+		if (compileNode(n->a, prog, 0) > EXPR_DIFF_STACK) error(0, "Expression too complex!");
+		ins.arg = prog.code.size() - pos;
+		prog.code.insert(prog.code.begin() + pos, ins);
+		return depth + 1;
+	}
+	default:
+	{
+		int peak = compileNode(n->a, prog, depth);
+		peak = max(peak, compileNode(n->b, prog, depth + 1));
+		prog.code.push_back(ins);
+		return peak;
+	}
+	}
+}
+Program compileTree(const NodePtr &tree)
+{
+	Program prog;
+
+	prog.max_depth = compileNode(tree, prog, 0);
+	if (prog.max_depth > EXPR_MAX_STACK) error(0, "Expression too complex!");
+
+	return prog;
+}
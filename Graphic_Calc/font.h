@@ -0,0 +1,116 @@
+#include <string>
+#include <stdexcept>
+
+using namespace std;
+
+#define FONT_SIZE 5 //Glyphs are FONT_SIZE * FONT_SIZE pixels
+
+#pragma once
+/* BITMAP FONT */
+struct Glyph
+{
+	unsigned int mask = 0; //Bit y * FONT_SIZE + x is the pixel (x, y)
+	int width = 0; //Columns before the first empty one (at least 1), 0 if the char is unsupported
+
+	constexpr bool pixel(int x, int y) const { return (mask >> (y * FONT_SIZE + x)) & 1; }
+};
+
+struct Font //Glyphs of the ASCII chars, built at compile time
+{
+	Glyph glyphs[128];
+
+	constexpr Font() : glyphs()
+	{
+		add('A', 0b01100, 0b10010, 0b11110, 0b10010, 0b10010);
+		add('B', 0b11100, 0b10010, 0b11100, 0b10010, 0b11100);
+		add('C', 0b01110, 0b10000, 0b10000, 0b10000, 0b01110);
+		add('D', 0b11100, 0b10010, 0b10010, 0b10010, 0b11100);
+		add('E', 0b11110, 0b10000, 0b11100, 0b10000, 0b11110);
+		add('F', 0b11110, 0b10000, 0b11100, 0b10000, 0b10000);
+		add('G', 0b01110, 0b10000, 0b10110, 0b10010, 0b01110);
+		add('H', 0b10010, 0b10010, 0b11110, 0b10010, 0b10010);
+		add('I', 0b11100, 0b01000, 0b01000, 0b01000, 0b11100);
+		add('J', 0b11110, 0b00100, 0b00100, 0b10100, 0b01000);
+		add('K', 0b10010, 0b10100, 0b11000, 0b10100, 0b10010);
+		add('L', 0b10000, 0b10000, 0b10000, 0b10000, 0b11110);
+		add('M', 0b10001, 0b11011, 0b10101, 0b10001, 0b10001);
+		add('N', 0b10010, 0b11010, 0b10110, 0b10010, 0b10010);
+		add('O', 0b01100, 0b10010, 0b10010, 0b10010, 0b01100);
+		add('P', 0b11100, 0b10010, 0b11100, 0b10000, 0b10000);
+		add('Q', 0b11110, 0b10010, 0b10010, 0b10110, 0b11110);
+		add('R', 0b11100, 0b10010, 0b11100, 0b10010, 0b10010);
+		add('S', 0b01110, 0b10000, 0b01100, 0b00010, 0b11100);
+		add('T', 0b11111, 0b00100, 0b00100, 0b00100, 0b00100);
+		add('U', 0b10010, 0b10010, 0b10010, 0b10010, 0b01100);
+		add('V', 0b10001, 0b10001, 0b10001, 0b01010, 0b00100);
+		add('W', 0b10001, 0b10001, 0b10001, 0b10101, 0b01010);
+		add('X', 0b10001, 0b01010, 0b00100, 0b01010, 0b10001);
+		add('Y', 0b10001, 0b01010, 0b00100, 0b00100, 0b00100);
+		add('Z', 0b11111, 0b00010, 0b00100, 0b01000, 0b11111);
+		add('0', 0b11110, 0b10010, 0b10010, 0b10010, 0b11110);
+		add('1', 0b11000, 0b01000, 0b01000, 0b01000, 0b01000);
+		add('2', 0b11110, 0b00010, 0b11110, 0b10000, 0b11110);
+		add('3', 0b11110, 0b00010, 0b01110, 0b00010, 0b11110);
+		add('4', 0b10010, 0b10010, 0b11110, 0b00010, 0b00010);
+		add('5', 0b11110, 0b10000, 0b11110, 0b00010, 0b11110);
+		add('6', 0b11110, 0b10000, 0b11110, 0b10010, 0b11110);
+		add('7', 0b11110, 0b00010, 0b00010, 0b00010, 0b00010);
+		add('8', 0b11110, 0b10010, 0b11110, 0b10010, 0b11110);
+		add('9', 0b11110, 0b10010, 0b11110, 0b00010, 0b11110);
+		add('!', 0b10000, 0b10000, 0b10000, 0b00000, 0b10000);
+		add('?', 0b10000, 0b01000, 0b10000, 0b00000, 0b10000);
+		add('.', 0b00000, 0b00000, 0b00000, 0b00000, 0b10000);
+		add(',', 0b00000, 0b00000, 0b00000, 0b01000, 0b10000);
+		add(':', 0b00000, 0b10000, 0b00000, 0b10000, 0b00000);
+		add(';', 0b10000, 0b00000, 0b00000, 0b10000, 0b10000);
+		add('+', 0b00000, 0b01000, 0b11100, 0b01000, 0b00000);
+		add('-', 0b00000, 0b00000, 0b11100, 0b00000, 0b00000);
+		add('*', 0b10100, 0b01000, 0b10100, 0b00000, 0b00000);
+		add('/', 0b00100, 0b01000, 0b01000, 0b01000, 0b10000);
+		add('^', 0b01000, 0b10100, 0b00000, 0b00000, 0b00000);
+		add('(', 0b01000, 0b10000, 0b10000, 0b10000, 0b01000);
+		add(')', 0b10000, 0b01000, 0b01000, 0b01000, 0b10000);
+		add('=', 0b00000, 0b11100, 0b00000, 0b11100, 0b00000);
+		add('\'', 0b10000, 0b10000, 0b00000, 0b00000, 0b00000);
+		add('_', 0b00000, 0b00000, 0b00000, 0b00000, 0b11111);
+		add(' ', 0b00000, 0b00000, 0b00000, 0b00000, 0b00000);
+		add('|', 0b10000, 0b10000, 0b10000, 0b10000, 0b10000);
+	}
+	constexpr void add(char ch, int row0, int row1, int row2, int row3, int row4) //Rows from the top, the leftmost pixel is the highest bit; letters get both cases
+	{
+		const int rows[FONT_SIZE] = { row0, row1, row2, row3, row4 };
+		Glyph glyph;
+		for (int y = 0; y < FONT_SIZE; y++)
+			for (int x = 0; x < FONT_SIZE; x++)
+				if ((rows[y] >> (FONT_SIZE - 1 - x)) & 1) glyph.mask |= 1u << (y * FONT_SIZE + x);
+
+		//Width: up to the first empty column
+		while (glyph.width < FONT_SIZE)
+		{
+			bool empty = true;
+			for (int y = 0; y < FONT_SIZE; y++) empty = empty && !glyph.pixel(glyph.width, y);
+			if (empty) break;
+			glyph.width++;
+		}
+		if (glyph.width == 0) glyph.width = 1; //Space
+
+		glyphs[(int)ch] = glyph;
+		if (ch >= 'A' && ch <= 'Z') glyphs[ch - 'A' + 'a'] = glyph;
+	}
+};
+
+constexpr Font font;
+static_assert(font.glyphs['A'].width == 4 && font.glyphs[' '].width == 1 && font.glyphs['~'].width == 0, "Font table");
+
+const Glyph& fontGlyph(char ch) //Throws on unsupported chars
+{
+	unsigned char index = ch;
+	if (index >= 128 || font.glyphs[index].width == 0) throw invalid_argument("Char unsupported!");
+	return font.glyphs[index];
+}
+int fontLength(const string &content) //Pixels taken by content, every char is followed by one empty column
+{
+	int filled_px = 0;
+	for (char ch : content) filled_px += fontGlyph(ch).width + 1;
+	return filled_px;
+}
@@ -0,0 +1,216 @@
+#include <memory>
+#include <string.h>
+#include "expr.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define JIT_SUPPORTED
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+#define JIT_MAX_DEPTH 256 //Bigger stacks are left to the interpreter (keeps the frame under a page)
+
+#pragma once
+/* NATIVE CODE */
+typedef double(*JitFunc)(double);
+
+struct JitCode
+{
+	JitFunc func = nullptr; //Compiled program, called with x
+	void *mem = nullptr;
+	size_t size = 0;
+
+	JitCode() = default;
+	JitCode(const JitCode&) = delete; //Owns the mapping, a copy would free it twice
+	JitCode& operator=(const JitCode&) = delete;
+	~JitCode()
+	{
+#ifdef JIT_SUPPORTED
+#ifdef _WIN32
+		if (mem) VirtualFree(mem, 0, MEM_RELEASE);
+#else
+		if (mem) munmap(mem, size);
+#endif
+#endif
+	}
+};
+
+/* EMITTER */
+//The generated code keeps the evaluation stack in its own frame:
+//[rsp+0, rsp+32) shadow space for the calls (Win64), [rsp+32] x, [rsp+40+8*k] stack slot k.
+//Every call leaves the result in xmm0 and takes its arguments in xmm0/xmm1 on both ABIs.
+void jitEmit(vector<unsigned char> &buf, std::initializer_list<unsigned char> bytes)
+{
+	buf.insert(buf.end(), bytes);
+}
+void jitEmit32(vector<unsigned char> &buf, unsigned int val)
+{
+	for (int i = 0; i < 4; i++) buf.push_back((val >> (i * 8)) & 0xFF);
+}
+void jitEmit64(vector<unsigned char> &buf, unsigned long long val)
+{
+	for (int i = 0; i < 8; i++) buf.push_back((val >> (i * 8)) & 0xFF);
+}
+void jitSse(vector<unsigned char> &buf, unsigned char opcode, int xmm, int disp) //F2 0F opcode xmm, [rsp+disp]
+{
+	jitEmit(buf, { 0xF2, 0x0F, opcode, (unsigned char)(0x84 | (xmm << 3)), 0x24 });
+	jitEmit32(buf, disp);
+}
+void jitLoad(vector<unsigned char> &buf, int xmm, int disp) { jitSse(buf, 0x10, xmm, disp); } //movsd xmm, [rsp+disp]
+void jitStore(vector<unsigned char> &buf, int xmm, int disp) { jitSse(buf, 0x11, xmm, disp); } //movsd [rsp+disp], xmm
+void jitCall(vector<unsigned char> &buf, const void* target) //mov rax, target; call rax
+{
+	jitEmit(buf, { 0x48, 0xB8 });
+	jitEmit64(buf, (unsigned long long)target);
+	jitEmit(buf, { 0xFF, 0xD0 });
+}
+int jitSlot(int k) { return 40 + 8 * k; }
+
+/* LIBM FALLBACKS */
+double jitPow(double a, double b) { return pow(a, b); }
+
+/* COMPILER */
+bool jitAgrees(const Program &prog, JitFunc func) //Cheap guard on a fixed corpus, the fuzzing is tests/fuzz_jit.cpp
+{
+	static const double corpus[] = { 0.0, -0.0, 1.0, -1.0, 0.5, -0.5, 2.0, -2.0, 3.14159265359, -2.71828182846,
+		0.001, -0.001, 1e-9, -1e-9, 123.456, -987.654, 1e6, -1e6, 1e300, -1e300, INFINITY, -INFINITY, NAN };
+
+	for (double x : corpus)
+	{
+		double a = evaluate(prog, x),
+			b = func(x);
+		if (memcmp(&a, &b, sizeof(double)) != 0 && !(isnan(a) && isnan(b))) return false;
+	}
+
+	return true;
+}
+shared_ptr<JitCode> jitCompile(const Program &prog) //Translate the program into native code, nullptr if not possible
+{
+#ifndef JIT_SUPPORTED
+	return nullptr;
+#else
+	if (prog.max_depth > JIT_MAX_DEPTH || prog.code.size() == 0) return nullptr;
+
+	vector<unsigned char> buf;
+	int frame = jitSlot(prog.max_depth);
+	if (frame % 16 != 8) frame += 8; //Calls need rsp aligned to 16
+
+	//Prologue
+	jitEmit(buf, { 0x48, 0x81, 0xEC }); //sub rsp, frame
+	jitEmit32(buf, frame);
+	jitStore(buf, 0, 32);
+
+	int top = -1;
+	for (const Instruction &ins : prog.code)
+	{
+		switch (ins.op)
+		{
+		case OP_NUM:
+		{
+			unsigned long long bits;
+			memcpy(&bits, &ins.value, sizeof(double));
+			jitEmit(buf, { 0x48, 0xB8 }); //mov rax, value
+			jitEmit64(buf, bits);
+			jitEmit(buf, { 0x48, 0x89, 0x84, 0x24 }); //mov [rsp+slot], rax
+			jitEmit32(buf, jitSlot(++top));
+			break;
+		}
+		case OP_VAR_X:
+			jitLoad(buf, 0, 32);
+			jitStore(buf, 0, jitSlot(++top));
+			break;
+		case OP_PARAM: //Read at every call, the sliders move it
+			jitEmit(buf, { 0x48, 0xB8 }); //mov rax, address
+			jitEmit64(buf, (unsigned long long)(paramValues() + ins.arg));
+			jitEmit(buf, { 0xF2, 0x0F, 0x10, 0x00 }); //movsd xmm0, [rax]
+			jitStore(buf, 0, jitSlot(++top));
+			break;
+		case OP_SQUARE:
+			jitLoad(buf, 0, jitSlot(top));
+			jitSse(buf, 0x59, 0, jitSlot(top)); //mulsd
+			jitStore(buf, 0, jitSlot(top));
+			break;
+		case OP_ADD:
+		case OP_SUB:
+		case OP_MUL:
+		case OP_DIV:
+		{
+			static const unsigned char sse_op[] = { 0x58, 0x5C, 0x59, 0x5E }; //addsd, subsd, mulsd, divsd
+			top--;
+			jitLoad(buf, 0, jitSlot(top));
+			jitSse(buf, sse_op[ins.op - OP_ADD], 0, jitSlot(top + 1));
+			jitStore(buf, 0, jitSlot(top));
+			break;
+		}
+		case OP_POW:
+			top--;
+			jitLoad(buf, 0, jitSlot(top));
+			jitLoad(buf, 1, jitSlot(top + 1));
+			jitCall(buf, (const void*)&jitPow);
+			jitStore(buf, 0, jitSlot(top));
+			break;
+		case OP_FUNC:
+		{
+			UnaryFunc target = getFunc(ins.arg).unary; //Same pointer of the interpreter
+			if (!target) return nullptr;
+			jitLoad(buf, 0, jitSlot(top));
+			jitCall(buf, (const void*)target);
+			jitStore(buf, 0, jitSlot(top));
+			break;
+		}
+		case OP_FUNC2:
+		{
+			BinaryFunc target = getFunc(ins.arg).binary;
+			if (!target) return nullptr;
+			top--;
+			jitLoad(buf, 0, jitSlot(top));
+			jitLoad(buf, 1, jitSlot(top + 1));
+			jitCall(buf, (const void*)target);
+			jitStore(buf, 0, jitSlot(top));
+			break;
+		}
+		case OP_SLOT: //The part values are given by the batch evaluator only
+			return nullptr;
+		default: //diff and y are left to the interpreter
+			return nullptr;
+		}
+	}
+
+	//Epilogue
+	jitLoad(buf, 0, jitSlot(top));
+	jitEmit(buf, { 0x48, 0x81, 0xC4 }); //add rsp, frame
+	jitEmit32(buf, frame);
+	jitEmit(buf, { 0xC3 }); //ret
+
+	//Executable copy
+	shared_ptr<JitCode> jit = make_shared<JitCode>();
+	jit->size = buf.size();
+#ifdef _WIN32
+	jit->mem = VirtualAlloc(nullptr, jit->size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (!jit->mem) return nullptr;
+	memcpy(jit->mem, buf.data(), buf.size());
+	DWORD old_protect;
+	if (!VirtualProtect(jit->mem, jit->size, PAGE_EXECUTE_READ, &old_protect)) return nullptr;
+	FlushInstructionCache(GetCurrentProcess(), jit->mem, jit->size);
+#else
+	void *mem = mmap(nullptr, jit->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED) return nullptr;
+	jit->mem = mem;
+	memcpy(jit->mem, buf.data(), buf.size());
+	if (mprotect(jit->mem, jit->size, PROT_READ | PROT_EXEC) != 0) return nullptr;
+#endif
+	jit->func = (JitFunc)jit->mem;
+
+	//Never trust a backend that disagrees with the interpreter
+	if (!jitAgrees(prog, jit->func)) return nullptr;
+
+	return jit;
+#endif
+}
+void evaluate(const JitCode &jit, const double* xs, double* ys, size_t n) //Compute the native code for every x
+{
+	for (size_t i = 0; i < n; i++) ys[i] = jit.func(xs[i]);
+}
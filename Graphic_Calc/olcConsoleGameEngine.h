@@ -88,7 +88,53 @@ http://www.youtube.com/javidx9
 #include <condition_variable>
 using namespace std;
 
+#ifdef _WIN32
 #include <windows.h>
+#else
+// Terminal backend: the console types and key codes the engine and its users rely on
+#include <string>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+
+struct CHAR_INFO
+{
+	union { wchar_t UnicodeChar; char AsciiChar; } Char;
+	unsigned short Attributes;
+};
+
+struct SMALL_RECT
+{
+	short Left, Top, Right, Bottom;
+};
+
+#define VK_BACK			0x08
+#define VK_TAB			0x09
+#define VK_RETURN		0x0D
+#define VK_SHIFT		0x10
+#define VK_CONTROL		0x11
+#define VK_ESCAPE		0x1B
+#define VK_SPACE		0x20
+#define VK_LEFT			0x25
+#define VK_UP			0x26
+#define VK_RIGHT		0x27
+#define VK_DOWN			0x28
+#define VK_DELETE		0x2E
+#define VK_OEM_PLUS		0xBB
+#define VK_OEM_COMMA	0xBC
+#define VK_OEM_MINUS	0xBD
+#define VK_OEM_PERIOD	0xBE
+#define VK_OEM_6		0xDD
+#endif
+
+#define PRESENT_MAX_SPANS 16 // Changed rows written one by one, more are written as one box
+#define IDLE_WAIT_MS 500 // Longest sleep of an idle game thread, it looks at the keys again after it
+#define TERM_ESC_WAIT_MS 50 // Wait for the rest of an escape sequence split by read(), then ESC is a key alone
 
 enum COLOUR
 {
@@ -229,7 +275,11 @@ public:
 	bool Save(wstring sFile)
 	{
 		FILE *f = nullptr;
+#ifdef _WIN32
 		_wfopen_s(&f, sFile.c_str(), L"wb");
+#else
+		f = fopen(string(sFile.begin(), sFile.end()).c_str(), "wb");
+#endif
 		if (f == nullptr)
 			return false;
 
@@ -251,7 +301,11 @@ public:
 		nHeight = 0;
 
 		FILE *f = nullptr;
+#ifdef _WIN32
 		_wfopen_s(&f, sFile.c_str(), L"rb");
+#else
+		f = fopen(string(sFile.begin(), sFile.end()).c_str(), "rb");
+#endif
 		if (f == nullptr)
 			return false;
 
@@ -278,8 +332,10 @@ public:
 		m_nScreenWidth = 80;
 		m_nScreenHeight = 30;
 
+#ifdef _WIN32
 		m_hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 		m_hConsoleIn = GetStdHandle(STD_INPUT_HANDLE);
+#endif
 
 		m_keyNewState = new short[256];
 		m_keyOldState = new short[256];
@@ -293,6 +349,7 @@ public:
 		m_sAppName = L"Default";
 	}
 
+#ifdef _WIN32
 	// Update 14/09/2017 - Below is the original implementation of CreateConsole(). This works
 	// on many, but not all systems. A revised version is used below. This will be removed 
 	// once it is established the revision is stable. Jx9
@@ -402,12 +459,87 @@ public:
 		if (!SetConsoleMode(m_hConsoleIn, ENABLE_EXTENDED_FLAGS | ENABLE_WINDOW_INPUT | ENABLE_MOUSE_INPUT))
 			return Error(L"SetConsoleMode");
 
-		// Allocate memory for screen buffer
+		// Allocate memory for screen buffer, and for the copy of what the console shows
+		m_bufScreen = new CHAR_INFO[m_nScreenWidth*m_nScreenHeight];
+		memset(m_bufScreen, 0, sizeof(CHAR_INFO) * m_nScreenWidth * m_nScreenHeight);
+		m_bufFront = new CHAR_INFO[m_nScreenWidth*m_nScreenHeight];
+		memset(m_bufFront, 0, sizeof(CHAR_INFO) * m_nScreenWidth * m_nScreenHeight);
+		m_bFrontValid = false;
+		Invalidate(0, 0, m_nScreenWidth, m_nScreenHeight);
+
+		return 1;
+	}
+#else
+	// Terminal version: every character cell shows two pixels stacked with an upper half
+	// block, foreground the top one and background the bottom one. The font is left to the
+	// terminal, so the font width and height are unused.
+	int ConstructConsole(int width, int height, int, int)
+	{
+		if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO))
+			return Error(L"Not A Terminal");
+
+		m_nScreenWidth = width;
+		m_nScreenHeight = height;
+
+		winsize ws;
+		if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0)
+		{
+			if ((m_nScreenHeight + 1) / 2 > ws.ws_row)
+				return Error(L"Screen Height Too Big For The Terminal");
+			if (m_nScreenWidth > ws.ws_col)
+				return Error(L"Screen Width Too Big For The Terminal");
+		}
+
+		// Raw mode: keys arrive one by one without echo, reads never block
+		if (tcgetattr(STDIN_FILENO, &m_termOriginal) != 0)
+			return Error(L"tcgetattr");
+		termios raw = m_termOriginal;
+		raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+		raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+		raw.c_cc[VMIN] = 0;
+		raw.c_cc[VTIME] = 0;
+		if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) != 0)
+			return Error(L"tcsetattr");
+		m_bTermRaw = true;
+
+		const char *colorterm = getenv("COLORTERM");
+		m_bTrueColour = colorterm && (strstr(colorterm, "truecolor") || strstr(colorterm, "24bit"));
+
+		// Alternate screen, hidden cursor, window title
+		m_sOutput = "\x1b[?1049h\x1b[?25l\x1b[2J\x1b]0;" + string(m_sAppName.begin(), m_sAppName.end()) + "\x07";
+		m_nCursorX = m_nCursorY = -1;
+
+		// Allocate memory for screen buffer, and for the copy of what the terminal shows
 		m_bufScreen = new CHAR_INFO[m_nScreenWidth*m_nScreenHeight];
 		memset(m_bufScreen, 0, sizeof(CHAR_INFO) * m_nScreenWidth * m_nScreenHeight);
+		m_bufFront = new CHAR_INFO[m_nScreenWidth*m_nScreenHeight];
+		memset(m_bufFront, 0, sizeof(CHAR_INFO) * m_nScreenWidth * m_nScreenHeight);
+		m_bFrontValid = false;
+		Invalidate(0, 0, m_nScreenWidth, m_nScreenHeight);
 
 		return 1;
 	}
+#endif
+
+	// Mark [x1, x2) * [y1, y2) as drawn, the next present looks for changes there
+	void Invalidate(int x1, int y1, int x2, int y2)
+	{
+		Clip(x1, y1);
+		Clip(x2, y2);
+		if (x1 >= x2 || y1 >= y2)
+			return;
+
+		if (m_nDirtyX1 >= m_nDirtyX2)
+		{
+			m_nDirtyX1 = x1; m_nDirtyY1 = y1;
+			m_nDirtyX2 = x2; m_nDirtyY2 = y2;
+		}
+		else
+		{
+			m_nDirtyX1 = min(m_nDirtyX1, x1); m_nDirtyY1 = min(m_nDirtyY1, y1);
+			m_nDirtyX2 = max(m_nDirtyX2, x2); m_nDirtyY2 = max(m_nDirtyY2, y2);
+		}
+	}
 
 	virtual void Draw(int x, int y, wchar_t c = 0x2588, short col = 0x000F)
 	{
@@ -415,6 +547,7 @@ public:
 		{
 			m_bufScreen[y * m_nScreenWidth + x].Char.UnicodeChar = c;
 			m_bufScreen[y * m_nScreenWidth + x].Attributes = col;
+			Invalidate(x, y, x + 1, y + 1);
 		}
 	}
 
@@ -429,6 +562,7 @@ public:
 
 	void DrawString(int x, int y, wstring c, short col = 0x000F)
 	{
+		Invalidate(x, y, x + (int)c.size(), y + 1);
 		for (size_t i = 0; i < c.size(); i++)
 		{
 			m_bufScreen[y * m_nScreenWidth + x + i].Char.UnicodeChar = c[i];
@@ -438,6 +572,7 @@ public:
 
 	void DrawStringAlpha(int x, int y, wstring c, short col = 0x000F)
 	{
+		Invalidate(x, y, x + (int)c.size(), y + 1);
 		for (size_t i = 0; i < c.size(); i++)
 		{
 			if (c[i] != L' ')
@@ -601,8 +736,13 @@ public:
 
 	~olcConsoleGameEngine()
 	{
+#ifdef _WIN32
 		SetConsoleActiveScreenBuffer(m_hOriginalConsole);
+#else
+		RestoreTerminal();
+#endif
 		delete[] m_bufScreen;
+		delete[] m_bufFront;
 	}
 
 public:
@@ -614,12 +754,23 @@ public:
 		thread t = thread(&olcConsoleGameEngine::GameThread, this);
 
 		// Wait for thread to be exited
-		m_cvGameFinished.wait(unique_lock<mutex>(m_muxGame));
+		unique_lock<mutex> lock(m_muxGame);
+		m_cvGameFinished.wait(lock, [this] { return !m_bAtomActive; });
+		lock.unlock();
 
 		// Tidy up
 		t.join();
 	}
 
+	// Frame pacing: at most fps frames per second (0 runs as fast as possible). With bIdleWait
+	// the game thread sleeps until input arrives once a frame without input changed nothing on
+	// the screen, for applications that only move when the user does.
+	void SetFramePacing(float fps, bool bIdleWait)
+	{
+		m_fFrameTime = fps > 0 ? 1.0f / fps : 0;
+		m_bIdleWait = bIdleWait;
+	}
+
 	int ScreenWidth()
 	{
 		return m_nScreenWidth;
@@ -640,9 +791,14 @@ private:
 		auto tp1 = chrono::system_clock::now();
 		auto tp2 = chrono::system_clock::now();
 
-		// Run as fast as possible
+		// Run as fast as allowed
+		bool bIdle = false;
 		while (m_bAtomActive)
 		{				
+			// Nothing changes until the user does something
+			if (m_bIdleWait && bIdle)
+				WaitForInput();
+
 			// Handle Timing
 			tp2 = chrono::system_clock::now();
 			chrono::duration<float> elapsedTime = tp2 - tp1;
@@ -650,15 +806,22 @@ private:
 			float fElapsedTime = elapsedTime.count();
 
 			// Handle Keyboard Input
+			bool bInput = false;
+#ifndef _WIN32
+			ReadTerminalKeys();
+#endif
 			for (int i = 0; i < 256; i++)
 			{
+#ifdef _WIN32
 				m_keyNewState[i] = GetAsyncKeyState(i);
+#endif
 				
 				m_keys[i].bPressed = false;
 				m_keys[i].bReleased = false;
 
 				if (m_keyNewState[i] != m_keyOldState[i])
 				{
+					bInput = true;
 					if ((m_keyNewState[i] & 0x8000) && focus)
 					{
 						m_keys[i].bPressed = !m_keys[i].bHeld;
@@ -674,12 +837,13 @@ private:
 				m_keyOldState[i] = m_keyNewState[i];
 			}
 
+#ifdef _WIN32
 			// Handle Mouse Input - Check for window events
 			INPUT_RECORD inBuf[32];
 			DWORD events = 0;
 			GetNumberOfConsoleInputEvents(m_hConsoleIn, &events);
 			if(events > 0)
-				ReadConsoleInput(m_hConsoleIn, inBuf, events, &events);
+				ReadConsoleInput(m_hConsoleIn, inBuf, min(events, (DWORD)32), &events);
 
 			// Handle events - we only care about mouse clicks and movement
 			// for now
@@ -695,6 +859,7 @@ private:
 							{
 								m_mousePosX = inBuf[i].Event.MouseEvent.dwMousePosition.X;
 								m_mousePosY = inBuf[i].Event.MouseEvent.dwMousePosition.Y;
+								bInput = true;
 							}
 							break;
 
@@ -717,6 +882,7 @@ private:
 						// We don't care just at the moment
 				}
 			}
+#endif
 
 			for (int m = 0; m < 5; m++)
 			{
@@ -725,6 +891,7 @@ private:
 
 				if (m_mouseNewState[m] != m_mouseOldState[m])
 				{
+					bInput = true;
 					if (m_mouseNewState[m])
 					{
 						m_mouse[m].bPressed = true;
@@ -746,17 +913,359 @@ private:
 				m_bAtomActive = false;
 
 			// Update Title & Present Screen Buffer
+#ifdef _WIN32
 			wchar_t s[256];
 			swprintf_s(s, 256, L"%s FPS: %3.2f", m_sAppName.c_str(), 1.0f / fElapsedTime);
 			SetConsoleTitle(s);
-			WriteConsoleOutput(m_hConsole, m_bufScreen, { (short)m_nScreenWidth, (short)m_nScreenHeight }, { 0,0 }, &m_rectWindow);
+#endif
+			bool bChanged = PresentScreen();
 			//Get focus
+#ifdef _WIN32
 			focus = (GetConsoleWindow() == GetForegroundWindow());
+#endif
+
+			// A frame that received nothing and showed nothing new: the next ones would be the same
+			bIdle = !bInput && !bChanged;
+
+			// Frame cap
+			if (m_fFrameTime > 0)
+				this_thread::sleep_until(tp2 + chrono::duration_cast<chrono::system_clock::duration>(chrono::duration<float>(m_fFrameTime)));
 		}
 
+		unique_lock<mutex> lock(m_muxGame);
 		m_cvGameFinished.notify_one();
 	}
 
+	// Write to the console only the cells that changed since the last present:
+	// one span per changed row, or their bounding box when many rows changed.
+	// Returns whether anything was written.
+	bool PresentScreen()
+	{
+		if (m_nDirtyX1 >= m_nDirtyX2)
+			return false;
+
+		vector<SMALL_RECT> spans;
+		for (int y = m_nDirtyY1; y < m_nDirtyY2; y++)
+		{
+			CHAR_INFO *row = m_bufScreen + y * m_nScreenWidth, *front = m_bufFront + y * m_nScreenWidth;
+			auto same = [&](int x) { return m_bFrontValid && SameCell(row[x], front[x]); };
+
+			int x1 = m_nDirtyX1, x2 = m_nDirtyX2;
+			while (x1 < x2 && same(x1)) x1++;
+			while (x2 > x1 && same(x2 - 1)) x2--;
+			if (x1 < x2)
+				spans.push_back({ (short)x1, (short)y, (short)(x2 - 1), (short)y });
+		}
+
+#ifdef _WIN32
+		if (spans.size() > PRESENT_MAX_SPANS)
+		{
+			SMALL_RECT box = spans[0];
+			for (const SMALL_RECT &span : spans)
+			{
+				box.Left = min(box.Left, span.Left);
+				box.Right = max(box.Right, span.Right);
+			}
+			box.Bottom = spans.back().Bottom;
+			spans = { box };
+		}
+
+		for (SMALL_RECT &span : spans)
+		{
+			SMALL_RECT region = span;
+			WriteConsoleOutput(m_hConsole, m_bufScreen, { (short)m_nScreenWidth, (short)m_nScreenHeight }, { span.Left, span.Top }, &region);
+		}
+#else
+		WriteTerminal(spans);
+#endif
+
+		for (SMALL_RECT &span : spans)
+			for (int y = span.Top; y <= span.Bottom; y++)
+				memcpy(m_bufFront + y * m_nScreenWidth + span.Left, m_bufScreen + y * m_nScreenWidth + span.Left, sizeof(CHAR_INFO) * (span.Right - span.Left + 1));
+
+		m_bFrontValid = true;
+		m_nDirtyX1 = m_nDirtyX2 = 0;
+		return !spans.empty();
+	}
+
+	// Block until input arrives, or IDLE_WAIT_MS at most
+	void WaitForInput()
+	{
+#ifdef _WIN32
+		WaitForSingleObject(m_hConsoleIn, IDLE_WAIT_MS);
+#else
+		if (!m_sInput.empty() && !m_bInputPartial)
+			return;
+		pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+		poll(&pfd, 1, m_bInputPartial ? TERM_ESC_WAIT_MS : IDLE_WAIT_MS);
+#endif
+	}
+
+	static bool SameCell(const CHAR_INFO &a, const CHAR_INFO &b)
+	{
+		return a.Char.UnicodeChar == b.Char.UnicodeChar && a.Attributes == b.Attributes;
+	}
+
+#ifndef _WIN32
+	// Terminal output: the changed row spans become escape sequences for the character cells
+	// they touch, with cursor moves and colour changes only where needed, and the whole frame
+	// goes out in one write()
+	void WriteTerminal(const vector<SMALL_RECT> &spans)
+	{
+		for (size_t i = 0; i < spans.size(); i++)
+		{
+			// Spans of the two pixel rows of a character row are merged
+			int row = spans[i].Top / 2, x1 = spans[i].Left, x2 = spans[i].Right;
+			if (i + 1 < spans.size() && spans[i + 1].Top / 2 == row)
+			{
+				i++;
+				x1 = min(x1, (int)spans[i].Left);
+				x2 = max(x2, (int)spans[i].Right);
+			}
+
+			CHAR_INFO *top = m_bufScreen + 2 * row * m_nScreenWidth, *topFront = m_bufFront + 2 * row * m_nScreenWidth;
+			bool hasBottom = 2 * row + 1 < m_nScreenHeight; // An odd last row fills its cells
+			CHAR_INFO *bottom = hasBottom ? top + m_nScreenWidth : top, *bottomFront = hasBottom ? topFront + m_nScreenWidth : topFront;
+
+			for (int x = x1; x <= x2; x++)
+			{
+				if (m_bFrontValid && SameCell(top[x], topFront[x]) && SameCell(bottom[x], bottomFront[x]))
+					continue;
+
+				// Move there, forward on the same row is shorter
+				if (row != m_nCursorY)
+					m_sOutput += "\x1b[" + to_string(row + 1) + ";" + to_string(x + 1) + "H";
+				else if (x != m_nCursorX)
+					m_sOutput += "\x1b[" + to_string(x - m_nCursorX) + "C";
+
+				int colTop = TerminalColour(top[x]), colBottom = TerminalColour(bottom[x]);
+				if (colTop == colBottom)
+				{
+					if (colTop == m_nTermBg)
+						m_sOutput += " ";
+					else if (colTop == m_nTermFg)
+						m_sOutput += "\xE2\x96\x88"; // Full block
+					else
+					{
+						TerminalColourCode(true, colTop);
+						m_sOutput += " ";
+					}
+				}
+				else
+				{
+					if (colTop != m_nTermFg)
+						TerminalColourCode(false, colTop);
+					if (colBottom != m_nTermBg)
+						TerminalColourCode(true, colBottom);
+					m_sOutput += "\xE2\x96\x80"; // Upper half block
+				}
+
+				m_nCursorX = x + 1;
+				m_nCursorY = row;
+			}
+		}
+
+		FlushTerminal();
+	}
+
+	// Colour a pixel shows, shade blocks mix foreground and background
+	int TerminalColour(const CHAR_INFO &cell)
+	{
+		static const unsigned char palette[16][3] = {
+			{ 0, 0, 0 }, { 0, 0, 128 }, { 0, 128, 0 }, { 0, 128, 128 }, { 128, 0, 0 }, { 128, 0, 128 }, { 128, 128, 0 }, { 192, 192, 192 },
+			{ 128, 128, 128 }, { 0, 0, 255 }, { 0, 255, 0 }, { 0, 255, 255 }, { 255, 0, 0 }, { 255, 0, 255 }, { 255, 255, 0 }, { 255, 255, 255 } };
+		static const int levels[6] = { 0, 95, 135, 175, 215, 255 };
+
+		int fg = cell.Attributes & 0x0F, bg = (cell.Attributes >> 4) & 0x0F, cover;
+		switch (cell.Char.UnicodeChar)
+		{
+		case 0:
+		case L' ': cover = 0; break;
+		case PIXEL_QUARTER: cover = 1; break;
+		case PIXEL_HALF: cover = 2; break;
+		case PIXEL_THREEQUARTERS: cover = 3; break;
+		default: cover = 4; break;
+		}
+
+		int rgb[3];
+		for (int k = 0; k < 3; k++)
+			rgb[k] = (palette[fg][k] * cover + palette[bg][k] * (4 - cover)) / 4;
+		if (m_bTrueColour)
+			return rgb[0] << 16 | rgb[1] << 8 | rgb[2];
+
+		// Nearest entry of the 6x6x6 cube of the 256 colour palette
+		int cube[3] = { 0, 0, 0 };
+		for (int k = 0; k < 3; k++)
+			for (int l = 1; l < 6; l++)
+				if (abs(levels[l] - rgb[k]) < abs(levels[cube[k]] - rgb[k]))
+					cube[k] = l;
+		return 16 + 36 * cube[0] + 6 * cube[1] + cube[2];
+	}
+
+	void TerminalColourCode(bool background, int colour)
+	{
+		char code[32];
+		if (m_bTrueColour)
+			snprintf(code, sizeof(code), "\x1b[%d;2;%d;%d;%dm", background ? 48 : 38, colour >> 16, (colour >> 8) & 0xFF, colour & 0xFF);
+		else
+			snprintf(code, sizeof(code), "\x1b[%d;5;%dm", background ? 48 : 38, colour);
+		m_sOutput += code;
+		(background ? m_nTermBg : m_nTermFg) = colour;
+	}
+
+	void FlushTerminal()
+	{
+		size_t done = 0;
+		while (done < m_sOutput.size())
+		{
+			ssize_t n = write(STDOUT_FILENO, m_sOutput.data() + done, m_sOutput.size() - done);
+			if (n < 0 && errno != EINTR)
+				break;
+			if (n > 0)
+				done += n;
+		}
+		m_sOutput.clear();
+	}
+
+	void RestoreTerminal()
+	{
+		if (!m_bTermRaw)
+			return;
+
+		m_sOutput += "\x1b[0m\x1b[?25h\x1b[?1049l";
+		FlushTerminal();
+		tcsetattr(STDIN_FILENO, TCSAFLUSH, &m_termOriginal);
+		m_bTermRaw = false;
+	}
+
+	// Terminal input: characters, not key states. The keys of one keystroke are held down
+	// for a frame; the same keystroke again gets a frame with every key up first, so it is
+	// seen as a new press. Ctrl+C closes the application.
+	void ReadTerminalKeys()
+	{
+		char buf[256];
+		ssize_t n;
+		while ((n = read(STDIN_FILENO, buf, sizeof(buf))) > 0)
+			m_sInput.append(buf, n);
+
+		memset(m_keyNewState, 0, 256 * sizeof(short));
+
+		int vk, len;
+		bool shift, ctrl;
+		if (!(len = ParseTerminalKey(vk, shift, ctrl)))
+			return;
+		if (vk && (m_keyOldState[vk] & 0x8000))
+			return;
+		m_sInput.erase(0, len);
+
+		if (ctrl && vk == 'C')
+			m_bAtomActive = false;
+		if (vk)
+			m_keyNewState[vk] = (short)0x8000;
+		if (shift)
+			m_keyNewState[VK_SHIFT] = (short)0x8000;
+		if (ctrl)
+			m_keyNewState[VK_CONTROL] = (short)0x8000;
+	}
+
+	// Key code and modifiers of the first keystroke waiting, returns the bytes it takes
+	// (0 if none or its escape sequence is not all read yet, vk 0 if unknown). Symbols map to the keys of the Italian layout the
+	// Windows version reads.
+	int ParseTerminalKey(int &vk, bool &shift, bool &ctrl)
+	{
+		static const struct { char c; int vk; bool shift; } symbols[] = {
+			{ '+', VK_OEM_PLUS, false }, { '*', VK_OEM_PLUS, true }, { ',', VK_OEM_COMMA, false }, { ';', VK_OEM_COMMA, true },
+			{ '.', VK_OEM_PERIOD, false }, { ':', VK_OEM_PERIOD, true }, { '-', VK_OEM_MINUS, false }, { '_', VK_OEM_MINUS, true },
+			{ '!', '1', true }, { '"', '2', true }, { '$', '4', true }, { '%', '5', true }, { '&', '6', true },
+			{ '/', '7', true }, { '(', '8', true }, { ')', '9', true }, { '=', '0', true }, { '^', VK_OEM_6, true } };
+
+		vk = 0;
+		shift = ctrl = false;
+		if (m_sInput.empty())
+			return 0;
+
+		unsigned char c = m_sInput[0];
+		if (c == 0x1B)
+		{
+			// Control sequence: ESC [ params final or ESC O final, params "key;modifiers"
+			bool sequence = m_sInput.size() > 1 && (m_sInput[1] == '[' || m_sInput[1] == 'O');
+			size_t end = 2;
+			while (sequence && end < m_sInput.size() && (m_sInput[end] < 0x40 || m_sInput[end] > 0x7E))
+				end++;
+
+			// A read() can end inside the sequence: the rest is waited for, a lone ESC too
+			if (m_sInput.size() == 1 || (sequence && end == m_sInput.size()))
+			{
+				auto now = chrono::steady_clock::now();
+				if (!m_bInputPartial)
+				{
+					m_bInputPartial = true;
+					m_tInputPartial = now;
+				}
+				if (now - m_tInputPartial < chrono::milliseconds(TERM_ESC_WAIT_MS))
+					return 0;
+				sequence = false;
+			}
+			m_bInputPartial = false;
+
+			if (!sequence)
+			{
+				vk = VK_ESCAPE;
+				return 1;
+			}
+
+			int key = 0, mod = 1;
+			sscanf(m_sInput.c_str() + 2, "%d;%d", &key, &mod);
+			shift = (mod - 1) & 1;
+			ctrl = ((mod - 1) & 4) != 0;
+			switch (m_sInput[end])
+			{
+			case 'A': vk = VK_UP; break;
+			case 'B': vk = VK_DOWN; break;
+			case 'C': vk = VK_RIGHT; break;
+			case 'D': vk = VK_LEFT; break;
+			case '~': vk = key == 3 ? VK_DELETE : 0; break;
+			}
+			return (int)end + 1;
+		}
+
+		if (c >= 'a' && c <= 'z')
+			vk = c - 'a' + 'A';
+		else if (c >= 'A' && c <= 'Z')
+		{
+			vk = c;
+			shift = true;
+		}
+		else if (c >= '0' && c <= '9')
+			vk = c;
+		else if (c >= 1 && c <= 26 && c != '\t' && c != '\r' && c != '\n' && c != 0x08)
+		{
+			vk = c - 1 + 'A';
+			ctrl = true;
+		}
+		else
+		{
+			switch (c)
+			{
+			case ' ': vk = VK_SPACE; break;
+			case '\t': vk = VK_TAB; break;
+			case '\r':
+			case '\n': vk = VK_RETURN; break;
+			case 0x08:
+			case 0x7F: vk = VK_BACK; break;
+			default:
+				for (auto &symbol : symbols)
+					if (symbol.c == c)
+					{
+						vk = symbol.vk;
+						shift = symbol.shift;
+					}
+			}
+		}
+		return 1;
+	}
+#endif
+
 public:
 	// User MUST OVERRIDE THESE!!
 	virtual bool OnUserCreate() = 0;
@@ -766,7 +1275,7 @@ public:
 protected:
 	int m_nScreenWidth;
 	int m_nScreenHeight;
-	CHAR_INFO *m_bufScreen;
+	CHAR_INFO *m_bufScreen = nullptr;
 	atomic<bool> m_bAtomActive;
 	condition_variable m_cvGameFinished;
 	mutex m_muxGame;
@@ -784,24 +1293,46 @@ protected:
 
 
 protected:
-	int Error(wchar_t *msg)
+	int Error(const wchar_t *msg)
 	{
+#ifdef _WIN32
 		wchar_t buf[256];
 		FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM, NULL, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), buf, 256, NULL);
 		SetConsoleActiveScreenBuffer(m_hOriginalConsole);
 		wprintf(L"ERROR: %s\n\t%s\n", msg, buf);
+#else
+		const char *reason = errno ? strerror(errno) : "";
+		RestoreTerminal();
+		fwprintf(stderr, L"ERROR: %ls\n\t%s\n", msg, reason);
+#endif
 		return -1;
 	}
 
 private:
+#ifdef _WIN32
 	HANDLE m_hOriginalConsole;
 	CONSOLE_SCREEN_BUFFER_INFO m_OriginalConsoleInfo;
 	HANDLE m_hConsole;
 	HANDLE m_hConsoleIn;
 	SMALL_RECT m_rectWindow;
+#else
+	termios m_termOriginal;
+	bool m_bTermRaw = false; // m_termOriginal must be restored
+	bool m_bTrueColour = false; // 24 bit colours, otherwise the 256 colour palette
+	string m_sOutput; // Bytes of the next write()
+	string m_sInput; // Bytes read and not turned into keys yet
+	bool m_bInputPartial = false; // m_sInput starts with an escape sequence not all read yet
+	chrono::steady_clock::time_point m_tInputPartial; // When its first part was seen
+	int m_nCursorX = -1, m_nCursorY = -1, m_nTermFg = -1, m_nTermBg = -1; // Terminal state at the end of m_sOutput, -1 unknown
+#endif
+	CHAR_INFO *m_bufFront = nullptr; // Screen as last presented
+	bool m_bFrontValid = false; // m_bufFront matches the console
+	int m_nDirtyX1 = 0, m_nDirtyY1 = 0, m_nDirtyX2 = 0, m_nDirtyY2 = 0; // Drawn since the last present, empty if x1 >= x2
 	short *m_keyOldState;
 	short *m_keyNewState;
 	bool m_mouseOldState[5];
 	bool m_mouseNewState[5];
-	bool focus;
+	float m_fFrameTime = 0; // Shortest frame in seconds, 0 uncapped
+	bool m_bIdleWait = false; // Sleep while nothing happens
+	bool focus = true;
 };
@@ -0,0 +1,579 @@
+#include <vector>
+#include <math.h>
+#include <limits.h>
+#include <algorithm>
+#include "expr.h"
+#include "jit.h"
+
+#define SAMPLE_STRIDE 8 //Columns of a coarse grid cell, a power of 2
+#define SAMPLE_TOLERANCE 0.5 //Pixels a cell may deviate from a straight line without being subdivided
+#define REFINE_JUMP 2 //Pixels the slope may turn between two segments before looking inside them
+#define REFINE_STEPS 8 //Evaluations spent inside a steep pair of columns
+#define REFINE_BUDGET 4 //Refinement evaluations allowed per column and frame
+
+#pragma once
+/* SAMPLES */
+enum SEGMENT //Shape of the curve between a column and the next one
+{
+	SEG_UNKNOWN = 0, //Not refined yet, drawn as a line
+	SEG_LINE,
+	SEG_SPAN, //Line, and the curve also reaches [lo, hi] in between
+	SEG_BREAK //Discontinuity: the curve reaches lo leaving the column and hi entering the next one
+};
+struct ColumnSample
+{
+	double y = NAN;
+	SEGMENT seg = SEG_UNKNOWN;
+	double lo = 0, hi = 0;
+	bool deferred = false; //Grid column of a cell skipped off screen, only its grid points are sampled
+	double cell_lo = 0, cell_hi = 0; //Enclosure of the values of the deferred cell
+};
+struct SampleCache //Ring buffer of samples indexed by world column (screen column - offset_x)
+{
+	double zoom = 0; //Zoom of the samples, 0 if empty
+	int lo = 0, hi = 0; //Cached world columns [lo, hi)
+	vector<ColumnSample> ring; //Sample of world column w in ring[w mod size]
+
+	int slot(int w) const { return ((w % (int)ring.size()) + ring.size()) % ring.size(); }
+	ColumnSample& at(int w) { return ring[slot(w)]; }
+	const ColumnSample& at(int w) const { return ring[slot(w)]; }
+};
+struct SampleTask //Columns of a function to work on
+{
+	int func;
+	int begin, len; //World columns
+};
+
+/* PARAMETERS */
+struct ParamSplit //Program of a parametric function split where the parameters start
+{
+	vector<Program> parts; //Biggest subexpressions of x alone, empty if not split
+	vector<shared_ptr<JitCode>> jits; //Native parts, nullptr if not available
+	Program rest; //The program reading part k with OP_SLOT k
+};
+struct PartCache //Values of the parts by world column, kept while the parameters move
+{
+	double zoom = 0; //Zoom of the values, 0 if empty
+	vector<int> column; //World column held by every entry, INT_MIN if none
+	vector<double> values; //Values of the parts, one row per entry
+	vector<Interval> spans; //Enclosures of the parts up to the next column, NaN until the segment is refined
+
+	int slot(int w) const { return ((w % (int)column.size()) + column.size()) % column.size(); }
+};
+
+NodePtr splitNode(const NodePtr &n, vector<NodePtr> &parts) //Replace the biggest subtrees of x alone with slots
+{
+	if (!hasParam(n))
+	{
+		if (!hasX(n) || n->op == OP_VAR_X) return n; //Cheaper than a lookup
+
+		for (int k = 0; k < (int)parts.size(); k++)
+			if (sameNode(parts[k], n)) return mkParam(OP_SLOT, k);
+		parts.push_back(n);
+		return mkParam(OP_SLOT, parts.size() - 1);
+	}
+	if (n->op == OP_PARAM) return n;
+
+	Node split = *n;
+	split.a = splitNode(n->a, parts);
+	if (n->b) split.b = splitNode(n->b, parts);
+	return make_shared<const Node>(split);
+}
+ParamSplit splitProgram(const Program &prog) //Split a program of x and the parameters, no parts if it cannot be
+{
+	ParamSplit split;
+
+	//diff() needs the whole argument for its dual numbers, y is not sampled by column
+	if (any_of(prog.code.begin(), prog.code.end(), [](const Instruction &ins) { return ins.op == OP_DIFF || ins.op == OP_VAR_Y; })) return split;
+
+	try
+	{
+		vector<NodePtr> parts;
+		NodePtr rest = splitNode(buildTree(prog), parts);
+
+		for (const NodePtr &part : parts)
+		{
+			split.parts.push_back(compileTree(part));
+			optimizeProgram(split.parts.back());
+			split.jits.push_back(jitCompile(split.parts.back()));
+		}
+		split.rest = compileTree(rest);
+		optimizeProgram(split.rest);
+	}
+	catch (const exception &)
+	{
+		split = ParamSplit();
+	}
+
+	return split;
+}
+int fillParts(const ParamSplit &split, PartCache &cache, double zoom, int size, int begin, int end, bool use_jit) //Compute the parts at the world columns [begin, end] missing from the cache of size entries, returns the evaluations
+{
+	int count = split.parts.size();
+	if (cache.zoom != zoom || (int)cache.column.size() != size)
+	{
+		//Nothing reusable
+		cache.zoom = zoom;
+		cache.column.assign(size, INT_MIN);
+		cache.values.assign((size_t)size * count, NAN);
+		cache.spans.assign((size_t)size * count, Interval(NAN, NAN, false));
+	}
+
+	vector<int> ws;
+	vector<double> xs, ys;
+	for (int w = begin; w <= end; w++)
+		if (cache.column[cache.slot(w)] != w)
+		{
+			ws.push_back(w);
+			xs.push_back(w * zoom);
+		}
+	if (ws.size() == 0) return 0;
+
+	ys.resize(xs.size());
+	for (int k = 0; k < count; k++)
+	{
+		if (use_jit && split.jits[k]) evaluate(*split.jits[k], xs.data(), ys.data(), xs.size());
+		else evaluate(split.parts[k], xs.data(), ys.data(), xs.size());
+
+		for (int i = 0; i < (int)ws.size(); i++) cache.values[(size_t)cache.slot(ws[i]) * count + k] = ys[i];
+	}
+	for (int w : ws)
+	{
+		cache.column[cache.slot(w)] = w;
+		fill_n(cache.spans.begin() + (size_t)cache.slot(w) * count, count, Interval(NAN, NAN, false));
+	}
+
+	return ws.size() * count;
+}
+
+/* EVALUATION */
+struct Evaluator //Backend of a function
+{
+	const Program *prog = nullptr;
+	const JitCode *jit = nullptr; //Preferred when not null
+	const ParamSplit *split = nullptr; //Parametric: the columns are computed from the cached parts
+	PartCache *parts = nullptr; //Its spans are filled by the refinement
+};
+
+void evaluate(const Evaluator &eval, const double* xs, double* ys, size_t n)
+{
+	if (eval.jit) evaluate(*eval.jit, xs, ys, n);
+	else evaluate(*eval.prog, xs, ys, n);
+}
+void evaluateColumns(const Evaluator &eval, double zoom, const int* ws, double* ys, size_t n) //Compute the world columns ws
+{
+	vector<double> xs(n);
+	for (size_t i = 0; i < n; i++) xs[i] = ws[i] * zoom;
+	if (!eval.split)
+	{
+		evaluate(eval, xs.data(), ys, n);
+		return;
+	}
+
+	//Only the nodes of the parameters are computed, the parts come from the cache
+	int count = eval.split->parts.size();
+	vector<double> slots(n * count);
+	for (size_t i = 0; i < n; i++)
+	{
+		int entry = eval.parts->slot(ws[i]);
+		for (int k = 0; k < count; k++)
+			slots[i * count + k] = (eval.parts->column[entry] == ws[i]) ? eval.parts->values[(size_t)entry * count + k] : evaluate(eval.split->parts[k], xs[i]);
+	}
+	evaluate(eval.split->rest, xs.data(), slots.data(), count, ys, n);
+}
+Interval encloseSegment(const Evaluator &eval, double zoom, int w) //Enclosure between the world columns w and w + 1
+{
+	Interval xs(w * zoom, (w + 1) * zoom);
+	int entry = eval.split ? eval.parts->slot(w) : 0;
+	if (!eval.split || eval.parts->column[entry] != w) return evaluate(*eval.prog, xs);
+
+	//Only the nodes of the parameters are enclosed, the parts are enclosed once per zoom
+	int count = eval.split->parts.size();
+	Interval *slots = eval.parts->spans.data() + (size_t)entry * count;
+	for (int k = 0; k < count; k++)
+		if (isnan(slots[k].lo)) slots[k] = evaluate(eval.split->parts[k], xs);
+	return evaluate(eval.split->rest, xs, slots);
+}
+
+/* ADAPTIVE SAMPLER */
+int floorStride(int w) { return (w >= 0) ? w / SAMPLE_STRIDE * SAMPLE_STRIDE : -((-w + SAMPLE_STRIDE - 1) / SAMPLE_STRIDE * SAMPLE_STRIDE); }
+int ceilStride(int w) { return floorStride(w + SAMPLE_STRIDE - 1); }
+
+int sampleColumns(const Evaluator &eval, double zoom, SampleCache &cache, int begin, int end, bool store_end, const Interval &view) //Sample the world columns [begin, end] on the coarse grid where the curve can reach the world y range view, returns the evaluations
+{
+	//Every cell depends only on its own grid points, so the samples never depend on the pan history
+	struct Cell
+	{
+		int a, b;
+		double ya, yb;
+		bool split; //Subdivide whatever the midpoint says
+	};
+	const double tolerance = SAMPLE_TOLERANCE * zoom; //In world units
+	int cells = (end - begin) / SAMPLE_STRIDE;
+	vector<int> ws;
+	vector<double> ys;
+	vector<Cell> todo, next;
+
+	//Coarse grid, and one more point on both sides for the slope test
+	for (int k = -1; k <= cells + 1; k++)
+		ws.push_back(begin + k * SAMPLE_STRIDE);
+	ys.resize(ws.size());
+	evaluateColumns(eval, zoom, ws.data(), ys.data(), ws.size());
+	int evals = ws.size();
+
+	//The segment of a column is set by the cell it starts, so storing a grid point again keeps its refinement
+	for (int k = 0; k <= cells; k++)
+		if (k < cells || store_end) cache.at(begin + k * SAMPLE_STRIDE).y = ys[k + 1];
+	vector<bool> split(cells);
+	for (int k = 0; k < cells; k++)
+	{
+		//A turn of the slope bigger than the tolerance, in the cell or its neighbours (the deviation of a parabola is 1/8 of its second difference)
+		double turn_a = ys[k] - 2 * ys[k + 1] + ys[k + 2],
+			turn_b = ys[k + 1] - 2 * ys[k + 2] + ys[k + 3];
+		split[k] = abs(turn_a) / 8 > tolerance || abs(turn_b) / 8 > tolerance;
+	}
+
+	//Enclose whole ranges of cells: the ones never defined or off screen need no samples inside.
+	//Halve the ranges crossing the edge of the view, a straight cell alone is cheaper to sample than to enclose
+	vector<pair<int, int>> ranges = { { 0, cells } };
+	while (ranges.size() > 0)
+	{
+		int k0 = ranges.back().first,
+			k1 = ranges.back().second;
+		ranges.pop_back();
+		if (k1 - k0 == 0 || (k1 - k0 == 1 && !split[k0]))
+		{
+			for (int k = k0; k < k1; k++)
+				todo.push_back({ begin + k * SAMPLE_STRIDE, begin + (k + 1) * SAMPLE_STRIDE, ys[k + 1], ys[k + 2], split[k] });
+			continue;
+		}
+
+		Interval range = evaluate(*eval.prog, Interval((begin + k0 * SAMPLE_STRIDE) * zoom, (begin + k1 * SAMPLE_STRIDE) * zoom));
+		evals++;
+		bool empty = isEmpty(range),
+			off_screen = range.hi < view.lo || range.lo > view.hi;
+		if (!empty && !off_screen && k1 - k0 > 1 && (range.lo < view.lo || range.hi > view.hi))
+		{
+			int km = (k0 + k1) / 2;
+			ranges.push_back({ km, k1 });
+			ranges.push_back({ k0, km });
+		}
+		else if (!empty && !off_screen)
+		{
+			for (int k = k0; k < k1; k++)
+				todo.push_back({ begin + k * SAMPLE_STRIDE, begin + (k + 1) * SAMPLE_STRIDE, ys[k + 1], ys[k + 2], split[k] });
+		}
+		else
+		{
+			for (int w = begin + k0 * SAMPLE_STRIDE; w < begin + k1 * SAMPLE_STRIDE; w++)
+			{
+				ColumnSample &col = cache.at(w);
+				if ((w - begin) % SAMPLE_STRIDE != 0) col.y = NAN;
+				else
+				{
+					//Sampled again if the view reaches it (an empty cell never does)
+					col.deferred = off_screen;
+					col.cell_lo = range.lo;
+					col.cell_hi = range.hi;
+				}
+				col.seg = SEG_LINE;
+			}
+		}
+	}
+	for (const Cell &cell : todo)
+		cache.at(cell.a).deferred = false;
+
+	//Halve the cells until they are straight, one batch of midpoints per level
+	while (todo.size() > 0)
+	{
+		ws.clear();
+		for (const Cell &cell : todo)
+			ws.push_back((cell.a + cell.b) / 2);
+		ys.resize(ws.size());
+		evaluateColumns(eval, zoom, ws.data(), ys.data(), ws.size());
+		evals += ws.size();
+
+		next.clear();
+		for (int i = 0; i < (int)todo.size(); i++)
+		{
+			const Cell &cell = todo[i];
+			int m = (cell.a + cell.b) / 2;
+			double ym = ys[i];
+			cache.at(m).y = ym;
+			if (cell.b - cell.a == 2)
+			{
+				//Every column computed
+				cache.at(cell.a).seg = cache.at(m).seg = SEG_UNKNOWN;
+				continue;
+			}
+
+			int finite = isfinite(cell.ya) + isfinite(ym) + isfinite(cell.yb);
+			if (cell.split || (finite != 0 && finite != 3) || (finite == 3 && abs(ym - (cell.ya + cell.yb) / 2) > tolerance))
+			{
+				next.push_back({ cell.a, m, cell.ya, ym, false });
+				next.push_back({ m, cell.b, ym, cell.yb, false });
+				continue;
+			}
+
+			//Straight: the columns in between are interpolated
+			for (int w = cell.a; w < cell.b; w++)
+			{
+				ColumnSample &col = cache.at(w);
+				if (w != cell.a && w != m)
+					col.y = (w < m) ? cell.ya + (ym - cell.ya) * (w - cell.a) / (m - cell.a) : ym + (cell.yb - ym) * (w - m) / (cell.b - m);
+				col.seg = SEG_LINE;
+			}
+		}
+		swap(todo, next);
+	}
+
+	return evals;
+}
+int sampleParts(const Evaluator &eval, double zoom, SampleCache &cache, int begin, int end, bool store_end) //Compute every world column [begin, end] of a split function, the parts are cached so a column costs only the nodes of the parameters; returns the evaluations
+{
+	vector<int> ws;
+	for (int w = begin; w < end || (w == end && store_end); w++)
+		ws.push_back(w);
+	vector<double> ys(ws.size());
+	evaluateColumns(eval, zoom, ws.data(), ys.data(), ws.size());
+
+	for (int i = 0; i < (int)ws.size(); i++)
+	{
+		ColumnSample &col = cache.at(ws[i]);
+		col.y = ys[i];
+		col.seg = SEG_UNKNOWN;
+		col.deferred = false;
+	}
+
+	return ws.size();
+}
+int refineSegments(const Evaluator &eval, double zoom, SampleCache &cache, int begin, int end, int budget) //Classify the segments starting at the world columns [begin, end), the columns [begin - 1, end + 1] must be cached; returns the evaluations
+{
+	struct Jump
+	{
+		int w;
+		double xa, xb, ya, yb; //Interval with the biggest jump found
+		double lo, hi; //Values reached
+		bool broken;
+		bool cont; //Continuous for the interval evaluator
+	};
+	vector<Jump> jumps;
+	const double tolerance = SAMPLE_TOLERANCE * zoom;
+	int evals = 0;
+
+	for (int w = begin; w < end; w++)
+	{
+		ColumnSample &col = cache.at(w);
+		double y_prev = cache.at(w - 1).y,
+			y_next = cache.at(w + 1).y,
+			y_after = cache.at(w + 2).y;
+		if (col.seg != SEG_UNKNOWN) continue;
+		if (!isfinite(col.y) || !isfinite(y_next))
+		{
+			col.seg = SEG_LINE;
+			continue;
+		}
+
+		//Smooth if the slope barely turns from the previous segment and to the next one, steep or not.
+		//The neighbours in other cells may be deferred, so the segments at the edges of a cell are always enclosed (split functions have every column)
+		bool edge = !eval.split && (floorStride(w) == w || floorStride(w + 1) == w + 1);
+		if (!edge && abs((y_next - col.y) - (col.y - y_prev)) <= REFINE_JUMP * zoom && abs((y_after - y_next) - (y_next - col.y)) <= REFINE_JUMP * zoom)
+		{
+			col.seg = SEG_LINE;
+			continue;
+		}
+		if (evals + 1 + (int)(jumps.size() + 1) * REFINE_STEPS > budget) continue; //Left unknown when out of budget
+
+		//Continuous and between the ends: nothing to look for inside
+		Interval segment = encloseSegment(eval, zoom, w);
+		evals++;
+		if (segment.cont && segment.lo >= min(col.y, y_next) - tolerance && segment.hi <= max(col.y, y_next) + tolerance) col.seg = SEG_LINE;
+		else jumps.push_back({ w, w * zoom, (w + 1) * zoom, col.y, y_next, min(col.y, y_next), max(col.y, y_next), false, segment.cont });
+	}
+	if (jumps.size() == 0) return evals;
+
+	//Follow the biggest jump, one batch of midpoints per step
+	vector<double> xs(jumps.size()), ys(jumps.size());
+	for (int step = 0; step < REFINE_STEPS; step++)
+	{
+		for (int i = 0; i < (int)jumps.size(); i++)
+			xs[i] = (jumps[i].xa + jumps[i].xb) / 2;
+		evaluate(eval, xs.data(), ys.data(), xs.size());
+
+		for (int i = 0; i < (int)jumps.size(); i++)
+		{
+			Jump &jump = jumps[i];
+			double ym = ys[i];
+			if (jump.broken) continue;
+			if (!isfinite(ym))
+			{
+				//Hole or pole inside
+				jump.broken = true;
+				continue;
+			}
+
+			jump.lo = min(jump.lo, ym);
+			jump.hi = max(jump.hi, ym);
+			if (abs(ym - jump.ya) >= abs(jump.yb - ym)) jump.xb = xs[i], jump.yb = ym;
+			else jump.xa = xs[i], jump.ya = ym;
+		}
+	}
+
+	for (const Jump &jump : jumps)
+	{
+		ColumnSample &col = cache.at(jump.w);
+		double y_next = cache.at(jump.w + 1).y,
+			first_jump = abs(y_next - col.y);
+
+		if (!jump.cont && (jump.broken || abs(jump.yb - jump.ya) > max(REFINE_JUMP * zoom, first_jump / 2)))
+		{
+			//The jump did not shrink with the interval
+			col.seg = SEG_BREAK;
+			col.lo = jump.ya;
+			col.hi = jump.yb;
+		}
+		else if (jump.lo < min(col.y, y_next) - tolerance || jump.hi > max(col.y, y_next) + tolerance)
+		{
+			//Overshoot or oscillation
+			col.seg = SEG_SPAN;
+			col.lo = jump.lo;
+			col.hi = jump.hi;
+		}
+		else col.seg = SEG_LINE;
+	}
+
+	return evals + jumps.size() * REFINE_STEPS;
+}
+
+/* IMPLICIT CURVES */
+#define TRACE_TILE 64 //Cells on the side of the screen tile traced by one task, a power of 2
+
+struct TraceTask //Screen tile of a relation
+{
+	int func;
+	int col, row; //Pixel of the top left corner
+};
+struct TraceSegment //Piece of a curve, in pixels
+{
+	int x1, y1, x2, y2;
+};
+
+int traceRelation(const Program &prog, double zoom, int offset_x, int offset_y, int col, int row, int width, int height, vector<TraceSegment> &out) //Marching squares of F(x, y) = 0 between the pixel centers of the tile at (col, row), the screen is width * height pixels; returns the evaluations
+{
+	struct Quad
+	{
+		int c, r, size; //Cells of the tile
+		bool bounded; //Leaf: the enclosure is finite
+	};
+	int cols = min(TRACE_TILE, width - 1 - col),
+		rows = min(TRACE_TILE, height - 1 - row);
+	if (cols <= 0 || rows <= 0) return 0;
+	auto worldX = [&](int c) { return (col + c - offset_x) * zoom; };
+	auto worldY = [&](int r) { return (offset_y - row - r) * zoom; };
+
+	//Quadtree: a quad whose enclosure cannot be 0 has no curve inside
+	vector<Quad> quads = { { 0, 0, TRACE_TILE, false } }, cells;
+	int evals = 0;
+	while (quads.size() > 0)
+	{
+		Quad quad = quads.back();
+		quads.pop_back();
+		if (quad.c >= cols || quad.r >= rows) continue;
+
+		Interval f = evaluate(prog, Interval(worldX(quad.c), worldX(min(quad.c + quad.size, cols))), Interval(worldY(min(quad.r + quad.size, rows)), worldY(quad.r)));
+		evals++;
+		if (isEmpty(f) || f.lo > 0 || f.hi < 0) continue;
+
+		if (quad.size > 1)
+		{
+			int half = quad.size / 2;
+			quads.push_back({ quad.c, quad.r, half, false });
+			quads.push_back({ quad.c + half, quad.r, half, false });
+			quads.push_back({ quad.c, quad.r + half, half, false });
+			quads.push_back({ quad.c + half, quad.r + half, half, false });
+		}
+		else
+		{
+			quad.bounded = isfinite(f.lo) && isfinite(f.hi);
+			cells.push_back(quad);
+		}
+	}
+	if (cells.size() == 0) return evals;
+
+	//Corners of the cells left, each computed once
+	vector<int> corner((cols + 1) * (rows + 1), -1);
+	vector<double> xs, ys, fs;
+	for (const Quad &cell : cells)
+		for (int k = 0; k < 4; k++)
+		{
+			int c = cell.c + (k == 1 || k == 2),
+				r = cell.r + (k >= 2);
+			int &slot = corner[r * (cols + 1) + c];
+			if (slot != -1) continue;
+
+			slot = xs.size();
+			xs.push_back(worldX(c));
+			ys.push_back(worldY(r));
+		}
+	fs.resize(xs.size());
+	evaluate(prog, xs.data(), ys.data(), fs.data(), xs.size());
+	evals += xs.size();
+
+	for (const Quad &cell : cells)
+	{
+		//Corners clockwise from the top left, edge k goes from corner k to corner k + 1
+		double f[4];
+		for (int k = 0; k < 4; k++)
+			f[k] = fs[corner[(cell.r + (k >= 2)) * (cols + 1) + cell.c + (k == 1 || k == 2)]];
+		if (!isfinite(f[0]) || !isfinite(f[1]) || !isfinite(f[2]) || !isfinite(f[3])) continue;
+
+		//Where the sign changes along the edges
+		static const int corner_x[] = { 0, 1, 1, 0, 0 },
+			corner_y[] = { 0, 0, 1, 1, 0 };
+		bool cross[4], pole = false;
+		int px[4], py[4], crossings = 0;
+		for (int k = 0; k < 4; k++)
+		{
+			double fa = f[k], fb = f[(k + 1) % 4];
+			cross[k] = (fa >= 0) != (fb >= 0);
+			if (!cross[k]) continue;
+
+			double t = fa / (fa - fb),
+				cx = cell.c + corner_x[k] + t * (corner_x[k + 1] - corner_x[k]),
+				cy = cell.r + corner_y[k] + t * (corner_y[k + 1] - corner_y[k]);
+			if (!cell.bounded)
+			{
+				//Unbounded enclosure: a root makes F small where the sign changes, a pole makes it big
+				double fc = evaluate(prog, (col + cx - offset_x) * zoom, (offset_y - row - cy) * zoom);
+				evals++;
+				pole = pole || !(abs(fc) <= max(abs(fa), abs(fb)) / 4);
+			}
+			px[k] = (int)round(col + cx);
+			py[k] = (int)round(row + cy);
+			crossings++;
+		}
+		if (pole) continue;
+
+		if (crossings == 2)
+		{
+			int a = 0;
+			while (!cross[a]) a++;
+			int b = a + 1;
+			while (!cross[b]) b++;
+			out.push_back({ px[a], py[a], px[b], py[b] });
+		}
+		else if (crossings == 4)
+		{
+			//Saddle: the center tells which corners are joined
+			double center = (f[0] + f[1] + f[2] + f[3]) / 4;
+			int shift = ((center >= 0) == (f[0] >= 0)) ? 0 : 3; //Edges around corner 1 and 3, or around corner 0 and 2
+			for (int k = 0; k < 4; k += 2)
+			{
+				int a = (k + shift) % 4, b = (k + shift + 1) % 4;
+				out.push_back({ px[a], py[a], px[b], py[b] });
+			}
+		}
+	}
+
+	return evals;
+}
@@ -0,0 +1,82 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+using namespace std;
+
+#pragma once
+/* WORKER POOL */
+struct WorkerPool //Threads kept alive between runs, the calling thread works too
+{
+	vector<thread> threads;
+	mutex mtx;
+	condition_variable wake, done;
+	const function<void(int)> *job = nullptr;
+	int tasks = 0, next = 0, pending = 0; //Tasks of the current run, next to hand out, not finished yet
+	bool quit = false;
+
+	WorkerPool(int workers = -1) //-1: one thread per core
+	{
+		if (workers < 0) workers = max(1, (int)thread::hardware_concurrency());
+
+		for (int i = 1; i < workers; i++)
+			threads.push_back(thread(&WorkerPool::work, this));
+	}
+	~WorkerPool()
+	{
+		{
+			lock_guard<mutex> lock(mtx);
+			quit = true;
+		}
+		wake.notify_all();
+
+		for (thread &t : threads) t.join();
+	}
+
+	int size() const { return threads.size() + 1; }
+	void run(int count, const function<void(int)> &task) //Call task(0), ..., task(count - 1) in any order, returns when all are done
+	{
+		if (count <= 0) return;
+
+		unique_lock<mutex> lock(mtx);
+		job = &task;
+		tasks = count;
+		next = 0;
+		pending = count;
+		wake.notify_all();
+
+		//Help the workers
+		while (next < tasks)
+		{
+			int i = next++;
+			lock.unlock();
+			task(i);
+			lock.lock();
+			pending--;
+		}
+		done.wait(lock, [this] { return pending == 0; });
+
+		job = nullptr;
+		tasks = next = 0;
+	}
+	void work() //Worker thread body
+	{
+		unique_lock<mutex> lock(mtx);
+
+		for (;;)
+		{
+			wake.wait(lock, [this] { return quit || next < tasks; });
+			if (quit) return;
+
+			int i = next++;
+			const function<void(int)> *task = job;
+			lock.unlock();
+			(*task)(i);
+			lock.lock();
+			if (--pending == 0) done.notify_all();
+		}
+	}
+};
@@ -0,0 +1,509 @@
+#include <vector>
+#include <string>
+#include <memory>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "expr.h"
+#include "jit.h"
+#include "pool.h"
+#include "plot.h"
+
+#define PLOT_BACKGROUND 0x00F0 //Console attributes, the background colour is the one shown: white
+#define PLOT_AXES 0x0080 //Dark grey
+#define PALETTE_SIZE 12
+
+#pragma once
+/* FUNCTIONS */
+struct Function
+{
+	string function;
+	string derived; //function with every diff() expanded, empty if there are none
+	vector<string> postfix_code;
+	Program program; //Compiled postfix_code
+	bool relation = false; //F(x, y) = 0, traced on the screen instead of sampled by column
+	shared_ptr<JitCode> jit; //Native program, nullptr if not available
+	short color; //Console attribute
+	bool visible = true; //Hidden functions are not sampled nor drawn
+	SampleCache cache; //Samples kept between frames
+	bool parametric = false; //Uses a parameter, sampled again when one moves
+	ParamSplit split; //Subexpressions of x alone, cached by column in parts
+	PartCache parts;
+};
+
+/* PALETTE */
+struct PlotColor
+{
+	const char *name;
+	short color; //Console attribute
+};
+const PlotColor plotPalette[PALETTE_SIZE] = { //Given in turn to the new functions, then shared
+	{ "BLUE", 0x0090 }, { "RED", 0x00C0 }, { "GREEN", 0x00A0 }, { "MAGENTA", 0x00D0 }, { "CYAN", 0x00B0 }, { "YELLOW", 0x00E0 },
+	{ "DARK BLUE", 0x0010 }, { "DARK RED", 0x0040 }, { "DARK GREEN", 0x0020 }, { "DARK MAGENTA", 0x0050 }, { "DARK CYAN", 0x0030 }, { "DARK YELLOW", 0x0060 } };
+
+int paletteFind(const string &name) //Position of the color named name, -1 if missing
+{
+	for (int i = 0; i < PALETTE_SIZE; i++)
+		if (name == plotPalette[i].name) return i;
+	return -1;
+}
+short paletteNext(const vector<Function> &funcs) //The least used color, the first one on a tie
+{
+	int uses[PALETTE_SIZE] = { };
+	for (const Function &func : funcs)
+		for (int i = 0; i < PALETTE_SIZE; i++)
+			if (func.color == plotPalette[i].color) uses[i]++;
+	return plotPalette[min_element(uses, uses + PALETTE_SIZE) - uses].color;
+}
+
+Function compileFunction(const string &expr) //Parse, compile and optimize expr, throws on syntax errors
+{
+	Function func;
+	func.function = expr;
+	func.postfix_code = parseInfix(expr);
+	func.relation = isRelation(func.postfix_code);
+	func.program = compilePostfix(func.postfix_code);
+
+	//Symbolic derivatives, dual numbers are kept if the result is too big
+	if (find_if(func.program.code.begin(), func.program.code.end(), [](const Instruction &ins) { return ins.op == OP_DIFF; }) != func.program.code.end())
+	{
+		try
+		{
+			NodePtr tree = expandDiff(buildTree(func.program));
+			func.program = compileTree(tree);
+			func.derived = toInfix(tree) + (func.relation ? "=0" : "");
+		}
+		catch (const exception &) { }
+	}
+
+	//Optimize and translate to native code
+	optimizeProgram(func.program);
+	func.jit = jitCompile(func.program);
+
+	//A parameter change computes only what depends on it
+	func.parametric = any_of(func.program.code.begin(), func.program.code.end(), [](const Instruction &ins) { return ins.op == OP_PARAM; });
+	if (func.parametric && !func.relation) func.split = splitProgram(func.program);
+
+	return func;
+}
+
+/* CANVAS */
+struct Canvas //Framebuffer of console attributes, any size
+{
+	int width = 0, height = 0;
+	vector<short> pixels;
+
+	Canvas(int width = 0, int height = 0) : width(width), height(height), pixels(width * height, PLOT_BACKGROUND) { }
+
+	void draw(int x, int y, short color)
+	{
+		if (x >= 0 && x < width && y >= 0 && y < height) pixels[y * width + x] = color;
+	}
+	void line(int x1, int y1, int x2, int y2, short color) //Bresenham, the same pixels of the console engine DrawLine
+	{
+		int dx = x2 - x1, dy = y2 - y1,
+			dx1 = abs(dx), dy1 = abs(dy),
+			px = 2 * dy1 - dx1, py = 2 * dx1 - dy1,
+			step = ((dx < 0 && dy < 0) || (dx > 0 && dy > 0)) ? 1 : -1;
+
+		if (dy1 <= dx1)
+		{
+			int x = (dx >= 0) ? x1 : x2, y = (dx >= 0) ? y1 : y2, xe = (dx >= 0) ? x2 : x1;
+			draw(x, y, color);
+			while (x < xe)
+			{
+				x++;
+				if (px < 0) px += 2 * dy1;
+				else
+				{
+					y += step;
+					px += 2 * (dy1 - dx1);
+				}
+				draw(x, y, color);
+			}
+		}
+		else
+		{
+			int x = (dy >= 0) ? x1 : x2, y = (dy >= 0) ? y1 : y2, ye = (dy >= 0) ? y2 : y1;
+			draw(x, y, color);
+			while (y < ye)
+			{
+				y++;
+				if (py <= 0) py += 2 * dx1;
+				else
+				{
+					x += step;
+					py += 2 * (dx1 - dy1);
+				}
+				draw(x, y, color);
+			}
+		}
+	}
+};
+
+/* PLOT RENDERER */
+Evaluator functionEvaluator(Function &func, bool use_jit) //Backend of the sampler, the parametric functions read their cached parts
+{
+	Evaluator eval = { &func.program, use_jit ? func.jit.get() : nullptr };
+	if (func.split.parts.size() > 0)
+	{
+		eval.split = &func.split;
+		eval.parts = &func.parts;
+	}
+	return eval;
+}
+int renderPlot(vector<Function> &funcs, double zoom, int offset_x, int offset_y, bool use_jit, WorkerPool &pool, Canvas &canvas) //Draw the axes and the functions, the world origin is at the pixel (offset_x, offset_y); returns the evaluations
+{
+	int width = canvas.width, height = canvas.height;
+
+	//Background and axys
+	canvas.pixels.assign(width * height, PLOT_BACKGROUND);
+	canvas.line(offset_x, 0, offset_x, height, PLOT_AXES);
+	canvas.line(0, offset_y, width, offset_y, PLOT_AXES);
+
+	//Visible world columns and one more on both sides (for the refinement), widened to the coarse grid
+	int cols = width + 1,
+		first = floorStride(-offset_x - 1),
+		last = ceilStride(-offset_x + cols),
+		ring_size = cols * 2 + SAMPLE_STRIDE * 2,
+		count = funcs.size(),
+		shown = count_if(funcs.begin(), funcs.end(), [](const Function &func) { return func.visible; });
+	Interval view((offset_y - height) * zoom, (offset_y + 1) * zoom); //World y range, one more row on both sides
+
+	//Find the grid ranges missing from the caches, and the cells skipped off screen that the view reaches now
+	vector<SampleTask> missing;
+	vector<bool> store_end; //Whether the range owns its last grid point
+	int missing_cols = 0;
+	for (int i = 0; i < count; i++)
+	{
+		SampleCache &cache = funcs[i].cache;
+		if (funcs[i].relation || !funcs[i].visible) continue;
+
+		if (cache.zoom != zoom || (int)cache.ring.size() != ring_size || cache.lo == cache.hi || last < cache.lo || first > cache.hi - 1)
+		{
+			//Nothing reusable
+			cache.zoom = zoom;
+			cache.ring.assign(ring_size, ColumnSample());
+			cache.lo = cache.hi = first;
+			missing.push_back({ i, first, last - first });
+			store_end.push_back(true);
+		}
+		else
+		{
+			for (int w = max(first, cache.lo); w < min(last, cache.hi - 1); w += SAMPLE_STRIDE)
+			{
+				const ColumnSample &col = cache.at(w);
+				if (col.deferred && col.cell_hi >= view.lo && col.cell_lo <= view.hi)
+				{
+					missing.push_back({ i, w, SAMPLE_STRIDE });
+					store_end.push_back(false);
+				}
+			}
+			if (first < cache.lo)
+			{
+				missing.push_back({ i, first, cache.lo - first });
+				store_end.push_back(false);
+			}
+			if (last > cache.hi - 1)
+			{
+				missing.push_back({ i, cache.hi - 1, last - cache.hi + 1 });
+				store_end.push_back(true);
+			}
+		}
+
+		//Keep the ring on the side of the view, the new columns take the slots of the dropped ones
+		int lo = min(cache.lo, first),
+			hi = max(cache.hi, last + 1);
+		if (hi - lo > ring_size)
+		{
+			if (first < cache.lo) hi = floorStride(lo + ring_size - 1) + 1;
+			else lo = ceilStride(hi - ring_size);
+		}
+		cache.lo = lo;
+		cache.hi = hi;
+	}
+	for (const SampleTask &range : missing) missing_cols += range.len;
+
+	//Parts of the parametric functions, computed once per column and zoom (the grid reaches a cell more on both sides)
+	vector<int> filling;
+	for (const SampleTask &range : missing)
+		if (funcs[range.func].split.parts.size() > 0 && (filling.size() == 0 || filling.back() != range.func)) filling.push_back(range.func);
+
+	vector<int> fill_evals(filling.size());
+	pool.run(filling.size(), [&](int t)
+	{
+		Function &func = funcs[filling[t]];
+		fill_evals[t] = fillParts(func.split, func.parts, zoom, ring_size + SAMPLE_STRIDE * 4, first - SAMPLE_STRIDE, last + SAMPLE_STRIDE, use_jit);
+	});
+
+	//Sample them, one task per function and screen strip
+	vector<SampleTask> tasks;
+	vector<bool> task_store_end;
+	int strip_w = ceilStride(max(32, (missing_cols + pool.size() * 4 - 1) / (pool.size() * 4)));
+	for (int r = 0; r < (int)missing.size(); r++)
+	{
+		const SampleTask &range = missing[r];
+		for (int w = range.begin; w < range.begin + range.len; w += strip_w)
+		{
+			tasks.push_back({ range.func, w, min(strip_w, range.begin + range.len - w) });
+			task_store_end.push_back(store_end[r] && w + strip_w >= range.begin + range.len);
+		}
+	}
+
+	vector<int> task_evals(tasks.size());
+	pool.run(tasks.size(), [&](int t)
+	{
+		const SampleTask &task = tasks[t];
+		Function &func = funcs[task.func];
+		Evaluator eval = functionEvaluator(func, use_jit);
+
+		//Every column of a split function is cheaper than the sampler, the parts of x are already there
+		if (eval.split) task_evals[t] = sampleParts(eval, zoom, func.cache, task.begin, task.begin + task.len, task_store_end[t]);
+		else task_evals[t] = sampleColumns(eval, zoom, func.cache, task.begin, task.begin + task.len, task_store_end[t], view);
+	});
+
+	//Look inside the steep segments on screen, within the budget
+	vector<SampleTask> refine;
+	int refine_w = max(32, cols * shown / (pool.size() * 4));
+	for (int i = 0; i < count; i++)
+	{
+		if (funcs[i].relation || !funcs[i].visible) continue;
+		for (int w = -offset_x; w < -offset_x + cols - 1; w += refine_w)
+			refine.push_back({ i, w, min(refine_w, -offset_x + cols - 1 - w) });
+	}
+
+	vector<int> refine_evals(refine.size());
+	pool.run(refine.size(), [&](int t)
+	{
+		const SampleTask &task = refine[t];
+		Function &func = funcs[task.func];
+
+		refine_evals[t] = refineSegments(functionEvaluator(func, use_jit), zoom, func.cache, task.begin, task.begin + task.len, REFINE_BUDGET * task.len);
+	});
+
+	//Trace the relations, one task per function and screen tile
+	vector<TraceTask> traces;
+	for (int i = 0; i < count; i++)
+	{
+		if (!funcs[i].relation || !funcs[i].visible) continue;
+		for (int row = 0; row < height - 1; row += TRACE_TILE)
+			for (int col = 0; col < width - 1; col += TRACE_TILE)
+				traces.push_back({ i, col, row });
+	}
+
+	vector<vector<TraceSegment>> trace_segs(traces.size());
+	vector<int> trace_evals(traces.size());
+	pool.run(traces.size(), [&](int t)
+	{
+		const TraceTask &task = traces[t];
+		trace_evals[t] = traceRelation(funcs[task.func].program, zoom, offset_x, offset_y, task.col, task.row, width, height, trace_segs[t]);
+	});
+
+	int evals = 0;
+	for (int n : fill_evals) evals += n;
+	for (int n : task_evals) evals += n;
+	for (int n : refine_evals) evals += n;
+	for (int n : trace_evals) evals += n;
+
+	//Rasterize in function order, as the serial sweep did
+	auto screenY = [&](double y) { return (int)max(-1.0, min((double)height, offset_y - round(y / zoom))); }; //Clamped around the canvas
+	int trace = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (!funcs[i].visible) continue;
+		const SampleCache &cache = funcs[i].cache;
+		short color = funcs[i].color;
+
+		for (; trace < (int)traces.size() && traces[trace].func == i; trace++)
+			for (const TraceSegment &seg : trace_segs[trace])
+				canvas.line(seg.x1, seg.y1, seg.x2, seg.y2, color);
+		if (funcs[i].relation) continue;
+
+		for (int x = 1; x < cols; x++)
+		{
+			const ColumnSample &a = cache.at(x - 1 - offset_x),
+				&b = cache.at(x - offset_x);
+			if (!isfinite(a.y) || !isfinite(b.y)) continue; //Impossible
+
+			int ya = screenY(a.y),
+				yb = screenY(b.y);
+
+			switch (a.seg)
+			{
+			case SEG_BREAK:
+				//Up to the jump and away from it
+				canvas.line(x - 1, ya, x - 1, screenY(a.lo), color);
+				canvas.line(x, screenY(a.hi), x, yb, color);
+				break;
+			case SEG_SPAN:
+				canvas.line(x, screenY(a.lo), x, screenY(a.hi), color);
+				//Falls through - and the line
+			default:
+				//Draw line if not out of the canvas
+				if ((ya >= 0 || yb >= 0) && (ya < height || yb < height))
+					canvas.line(x - 1, ya, x, yb, color);
+				break;
+			}
+		}
+	}
+
+	return evals;
+}
+
+/* IMAGE EXPORT */
+const unsigned char consolePalette[16][3] = { //Default console colours
+	{ 0, 0, 0 }, { 0, 0, 128 }, { 0, 128, 0 }, { 0, 128, 128 }, { 128, 0, 0 }, { 128, 0, 128 }, { 128, 128, 0 }, { 192, 192, 192 },
+	{ 128, 128, 128 }, { 0, 0, 255 }, { 0, 255, 0 }, { 0, 255, 255 }, { 255, 0, 0 }, { 255, 0, 255 }, { 255, 255, 0 }, { 255, 255, 255 } };
+
+int paletteIndex(short color) { return (color >> 4) & 0x0F; } //Background colour of the attribute
+
+bool savePPM(const Canvas &canvas, const string &path)
+{
+	FILE *f = fopen(path.c_str(), "wb");
+	if (!f) return false;
+
+	vector<unsigned char> data(canvas.pixels.size() * 3);
+	for (size_t i = 0; i < canvas.pixels.size(); i++)
+		memcpy(&data[i * 3], consolePalette[paletteIndex(canvas.pixels[i])], 3);
+
+	fprintf(f, "P6\n%d %d\n255\n", canvas.width, canvas.height);
+	bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+	return fclose(f) == 0 && ok;
+}
+
+struct BitWriter //Deflate bit stream, least significant bit first
+{
+	vector<unsigned char> &out;
+	unsigned int bits = 0;
+	int count = 0;
+
+	BitWriter(vector<unsigned char> &out) : out(out) { }
+	void put(unsigned int value, int n)
+	{
+		bits |= value << count;
+		count += n;
+		while (count >= 8)
+		{
+			out.push_back(bits & 0xFF);
+			bits >>= 8;
+			count -= 8;
+		}
+	}
+	void putCode(unsigned int code, int n) //Huffman codes go most significant bit first
+	{
+		unsigned int reversed = 0;
+		for (int i = 0; i < n; i++) reversed |= ((code >> i) & 1) << (n - 1 - i);
+		put(reversed, n);
+	}
+	void flush()
+	{
+		if (count > 0) out.push_back(bits & 0xFF);
+		bits = count = 0;
+	}
+};
+void deflateLiteral(BitWriter &bw, int lit) //Fixed Huffman code of a literal or length symbol
+{
+	if (lit < 144) bw.putCode(0x30 + lit, 8);
+	else if (lit < 256) bw.putCode(0x190 + lit - 144, 9);
+	else if (lit < 280) bw.putCode(lit - 256, 7);
+	else bw.putCode(0xC0 + lit - 280, 8);
+}
+void deflateRun(BitWriter &bw, int len) //Copy of the previous byte, 3 <= len <= 258
+{
+	static const int base[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const int extra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+	int code = 28;
+	while (base[code] > len) code--;
+	deflateLiteral(bw, 257 + code);
+	bw.put(len - base[code], extra[code]);
+	bw.putCode(0, 5); //Distance 1
+}
+vector<unsigned char> zlibRuns(const vector<unsigned char> &data) //Zlib stream of data, one fixed Huffman block of literals and runs
+{
+	vector<unsigned char> out = { 0x78, 0x01 };
+	BitWriter bw(out);
+	bw.put(1, 1); //Last block
+	bw.put(1, 2); //Fixed codes
+
+	for (size_t i = 0; i < data.size();)
+	{
+		deflateLiteral(bw, data[i]);
+		size_t run = i + 1;
+		while (run < data.size() && data[run] == data[i]) run++;
+		for (i++; run - i >= 3; )
+		{
+			int len = min<size_t>(258, run - i);
+			if (run - i - len > 0 && run - i - len < 3) len -= 3; //Leave a copy, not 1 or 2 literals
+			deflateRun(bw, len);
+			i += len;
+		}
+	}
+	deflateLiteral(bw, 256); //End of block
+	bw.flush();
+
+	unsigned int a = 1, b = 0;
+	for (size_t i = 0; i < data.size(); i += 5552) //Longest block that cannot overflow b
+	{
+		for (size_t j = i; j < min(data.size(), i + 5552); j++)
+		{
+			a += data[j];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	unsigned int adler = (b << 16) | a;
+	for (int i = 3; i >= 0; i--) out.push_back((adler >> (i * 8)) & 0xFF);
+
+	return out;
+}
+void pngChunk(vector<unsigned char> &png, const char *type, const vector<unsigned char> &data)
+{
+	static unsigned int table[256] = { 0 };
+	if (!table[1])
+		for (unsigned int n = 0; n < 256; n++)
+		{
+			unsigned int c = n;
+			for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+
+	size_t start = png.size();
+	for (int i = 3; i >= 0; i--) png.push_back((data.size() >> (i * 8)) & 0xFF);
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+
+	unsigned int crc = 0xFFFFFFFF;
+	for (size_t i = start + 4; i < png.size(); i++) crc = table[(crc ^ png[i]) & 0xFF] ^ (crc >> 8);
+	crc ^= 0xFFFFFFFF;
+	for (int i = 3; i >= 0; i--) png.push_back((crc >> (i * 8)) & 0xFF);
+}
+bool savePNG(const Canvas &canvas, const string &path) //Palette image, plots are mostly runs so they are deflated as copies of the previous pixel
+{
+	vector<unsigned char> rows;
+	rows.reserve((canvas.width + 1) * canvas.height);
+	for (int y = 0; y < canvas.height; y++)
+	{
+		rows.push_back(0); //No filter
+		for (int x = 0; x < canvas.width; x++) rows.push_back(paletteIndex(canvas.pixels[y * canvas.width + x]));
+	}
+
+	vector<unsigned char> header, palette;
+	for (int value : { canvas.width, canvas.height })
+		for (int i = 3; i >= 0; i--) header.push_back((value >> (i * 8)) & 0xFF);
+	header.insert(header.end(), { 8, 3, 0, 0, 0 }); //8 bit palette indices
+	for (int i = 0; i < 16; i++) palette.insert(palette.end(), consolePalette[i], consolePalette[i] + 3);
+
+	vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	pngChunk(png, "IHDR", header);
+	pngChunk(png, "PLTE", palette);
+	pngChunk(png, "IDAT", zlibRuns(rows));
+	pngChunk(png, "IEND", {});
+
+	FILE *f = fopen(path.c_str(), "wb");
+	if (!f) return false;
+	bool ok = fwrite(png.data(), 1, png.size(), f) == png.size();
+	return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,65 @@
+/*
+* File:   bench_parse.cpp
+*
+* parseInfix timings on nested and long flat expressions, the time per char must stay flat.
+* Build: g++ -std=c++14 -O2 bench_parse.cpp -o bench_parse
+*/
+
+#include <stdio.h>
+#include <chrono>
+#include "../expr.h"
+
+using namespace std::chrono;
+
+string nested(int depth) //sin(x*1.2345678901+sin(x*1.2345678901+...)), about 20 chars per level
+{
+	string expr;
+	for (int i = 0; i < depth; i++) expr += "sin(x*1.2345678901+";
+	expr += "x";
+	for (int i = 0; i < depth; i++) expr += ")";
+	return expr;
+}
+string flat(int length) //x*1.25+x*1.25+..., no nesting
+{
+	string expr = "x";
+	while ((int)expr.length() < length) expr += "+x*1.25";
+	return expr;
+}
+double timeParse(const string &expr) //Milliseconds per parse, best of the runs
+{
+	double best = 1e30;
+	for (int run = 0; run < 20; run++)
+	{
+		auto start = steady_clock::now();
+		vector<string> postfix = parseInfix(expr);
+		best = min(best, duration<double, milli>(steady_clock::now() - start).count());
+		if (postfix.empty()) return -1;
+	}
+	return best;
+}
+
+int main()
+{
+	bool linear = true;
+	double first = 0;
+
+	printf("%-8s %8s %10s %12s\n", "input", "chars", "ms", "ns/char");
+	for (int depth : { 125, 250, 500, 1000 })
+	{
+		string expr = nested(depth);
+		double ms = timeParse(expr), per_char = ms * 1e6 / expr.length();
+		printf("nest%-4d %8zu %10.3f %12.1f\n", depth, expr.length(), ms, per_char);
+
+		if (depth == 125) first = per_char;
+		else if (per_char > first * 4) linear = false; //Quadratic would grow 8 times by depth 1000
+	}
+	for (int length : { 2500, 5000, 10000, 20000 })
+	{
+		string expr = flat(length);
+		double ms = timeParse(expr);
+		printf("flat%-4s %8zu %10.3f %12.1f\n", "", expr.length(), ms, ms * 1e6 / expr.length());
+	}
+
+	printf(linear ? "OK: linear in the input length\n" : "FAIL: the time per char grows with the nesting\n");
+	return linear ? 0 : 1;
+}
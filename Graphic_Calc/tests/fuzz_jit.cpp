@@ -0,0 +1,111 @@
+/*
+* File:   fuzz_jit.cpp
+*
+* Differential fuzzing of the native code against the interpreter: random expressions, random x, the results must be the same bits.
+* Build: g++ -std=c++14 -O2 fuzz_jit.cpp -o fuzz_jit
+* Usage: fuzz_jit [EXPRESSIONS] [SEED]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include "../jit.h"
+
+mt19937 rng;
+
+string randomNumber()
+{
+	static const char* specials[] = { "0", "1", "2", "0.5", "3", "10", "0.001", "1000000" };
+	if (rng() % 2) return specials[rng() % 8];
+	return to_string(rng() % 1000) + "." + to_string(rng() % 1000);
+}
+string randomExpr(int depth) //Infix expression of x, constants, operators and every builtin the JIT calls
+{
+	static const char* unary[] = { "abs", "cos", "sin", "tan", "acos", "asin", "atan", "cosh", "sinh", "tanh", "acosh", "asinh", "atanh", "sqrt", "cbrt", "exp", "ln", "floor" };
+	static const char* binary[] = { "min", "max", "atan2" };
+	static const char ops[] = { '+', '-', '*', '/', '^' };
+
+	int pick = (depth == 0) ? rng() % 3 : rng() % 8;
+	switch (pick)
+	{
+	case 0: return "x";
+	case 1: return randomNumber();
+	case 2: return (rng() % 2) ? "e" : "p";
+	case 3: return string(unary[rng() % 18]) + "(" + randomExpr(depth - 1) + ")";
+	case 4: return string(binary[rng() % 3]) + "(" + randomExpr(depth - 1) + "," + randomExpr(depth - 1) + ")";
+	case 5: return "-(" + randomExpr(depth - 1) + ")";
+	default: return "(" + randomExpr(depth - 1) + ")" + ops[rng() % 5] + "(" + randomExpr(depth - 1) + ")";
+	}
+}
+double randomX()
+{
+	static const double specials[] = { 0.0, -0.0, 1.0, -1.0, INFINITY, -INFINITY, NAN, 1e-300, -1e300, 0.5 };
+	switch (rng() % 4)
+	{
+	case 0: return specials[rng() % 10];
+	case 1: return uniform_real_distribution<double>(-1, 1)(rng);
+	case 2: return uniform_real_distribution<double>(-100, 100)(rng);
+	default: //Any finite bit pattern
+	{
+		unsigned long long bits = ((unsigned long long)rng() << 32) | rng();
+		double x;
+		memcpy(&x, &bits, sizeof(double));
+		return isfinite(x) ? x : 0.0;
+	}
+	}
+}
+
+int main(int argc, char **argv)
+{
+#ifndef JIT_SUPPORTED
+	printf("SKIP: no native code on this architecture\n");
+	return 0;
+#else
+	int count = (argc > 1) ? atoi(argv[1]) : 20000;
+	rng.seed((argc > 2) ? atoi(argv[2]) : 1);
+	int compiled = 0, failures = 0;
+
+	for (int n = 0; n < count; n++)
+	{
+		string expr = randomExpr(1 + rng() % 5);
+		Program prog;
+		try
+		{
+			prog = compilePostfix(parseInfix(expr));
+		}
+		catch (const exception &ex)
+		{
+			printf("FAIL: %s on %s\n", ex.what(), expr.c_str());
+			return 1;
+		}
+		if (rng() % 2) optimizeProgram(prog);
+
+		//jitCompile also drops the code failing its own spot check, so a missing one is a failure too
+		shared_ptr<JitCode> jit = jitCompile(prog);
+		if (!jit)
+		{
+			printf("FAIL: not compiled %s\n", expr.c_str());
+			failures++;
+			continue;
+		}
+		compiled++;
+
+		for (int i = 0; i < 200; i++)
+		{
+			double x = randomX(),
+				a = evaluate(prog, x),
+				b = jit->func(x);
+			if (memcmp(&a, &b, sizeof(double)) != 0 && !(isnan(a) && isnan(b)))
+			{
+				if (failures < 20) printf("FAIL: %s at x=%.17g: interpreter %.17g, native %.17g\n", expr.c_str(), x, a, b);
+				failures++;
+				break;
+			}
+		}
+	}
+
+	printf("%d expressions, %d compiled, %d failures\n", count, compiled, failures);
+	printf(failures ? "FAIL: the native code disagrees with the interpreter\n" : "OK: same bits on every x\n");
+	return failures ? 1 : 0;
+#endif
+}
@@ -0,0 +1,59 @@
+/*
+* File:   test_alloc.cpp
+*
+* Counts the heap allocations of parsePostfix and evaluate once the expression is compiled, there must be none.
+* Build: g++ -std=c++14 -O2 test_alloc.cpp -o test_alloc
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include "../expr.h"
+
+static long allocations = 0;
+
+void* operator new(size_t size)
+{
+	allocations++;
+	void *p = malloc(size ? size : 1);
+	if (!p) throw bad_alloc();
+	return p;
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+int main()
+{
+	const char* exprs[] = { "sin(cos(exp(x)))", "diff(diff(x^3))+ln(abs(x))", "x^2+2*x+1", "atan2(x,2)*min(x,1)", "diff(sin(x)*x)/sqrt(x^2+1)" };
+	int failures = 0;
+
+	for (const char* expr : exprs)
+	{
+		//Allocated once per function, counted as well
+		long compile_before = allocations;
+		vector<string> postfix = parseInfix(expr);
+		Program prog = compilePostfix(postfix);
+		volatile double sink = 0;
+		if (allocations == compile_before)
+		{
+			printf("FAIL: operator new is not counted\n");
+			return 1;
+		}
+
+		long before = allocations;
+		for (int i = 0; i < 3000; i++)
+		{
+			double x = -15 + i * 0.01;
+			int status;
+			sink = sink + parsePostfix(postfix, x, &status);
+			sink = sink + evaluate(prog, x, &status);
+		}
+		long count = allocations - before;
+
+		printf("%-28s %ld allocations in 6000 evaluations\n", expr, count);
+		if (count != 0) failures++;
+	}
+
+	printf(failures ? "FAIL: the evaluators allocate\n" : "OK: no allocations\n");
+	return failures ? 1 : 0;
+}
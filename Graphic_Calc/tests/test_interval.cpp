@@ -0,0 +1,88 @@
+/*
+* File:   test_interval.cpp
+*
+* The interval evaluator must enclose every defined value over its range, or the plot culls a part of the curve.
+* Build: g++ -std=c++14 -O2 test_interval.cpp -o test_interval -lpthread
+* Usage: test_interval [EXPRESSIONS] [SEED]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include "../render.h"
+
+mt19937 rng;
+
+string randomExpr(int depth) //Infix expression of x mixing min and max with functions defined only on a part of the line
+{
+	static const char* unary[] = { "sqrt", "ln", "asin", "acosh", "abs", "sin", "exp", "floor" };
+	static const char* binary[] = { "min", "max" };
+	static const char ops[] = { '+', '-', '*' };
+
+	int pick = (depth == 0) ? rng() % 2 : rng() % 5;
+	switch (pick)
+	{
+	case 0: return "x";
+	case 1: return to_string((int)(rng() % 7) - 3);
+	case 2: return string(unary[rng() % 8]) + "(" + randomExpr(depth - 1) + ")";
+	case 3: return string(binary[rng() % 2]) + "(" + randomExpr(depth - 1) + "," + randomExpr(depth - 1) + ")";
+	default: return "(" + randomExpr(depth - 1) + ")" + ops[rng() % 3] + "(" + randomExpr(depth - 1) + ")";
+	}
+}
+
+bool encloses(const string &expr, const Program &prog) //Random ranges of x, the values at points inside each one must be in its interval
+{
+	uniform_real_distribution<double> center(-12, 12), width(0, 6), t(0, 1);
+	for (int r = 0; r < 50; r++)
+	{
+		double lo = center(rng), hi = lo + width(rng);
+		Interval range = evaluate(prog, Interval(lo, hi));
+
+		for (int i = 0; i <= 100; i++)
+		{
+			double x = (i == 100) ? hi : lo + (hi - lo) * (i == 0 ? 0 : t(rng)), y = evaluate(prog, x);
+			if ((!isnan(y) && !(y >= range.lo && y <= range.hi)) || (isnan(y) && range.cont))
+			{
+				printf("FAIL: %s at %.17g is %.17g, over [%.17g, %.17g] the interval is [%.17g, %.17g]%s\n", expr.c_str(), x, y, lo, hi, range.lo, range.hi, range.cont ? " continuous" : "");
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	int count = argc > 1 ? atoi(argv[1]) : 5000;
+	rng.seed(argc > 2 ? atoi(argv[2]) : 1);
+	int failures = 0;
+
+	//Defined operand against an undefined one, then random expressions
+	vector<string> exprs = { "max(1,sqrt(x))", "min(ln(x),2)", "max(x,sqrt(x+10))", "min(sqrt(-x),asin(x/4))", "max(0,sqrt(x))*2+min(ln(x),x)" };
+	for (int i = 0; i < count; i++) exprs.push_back(randomExpr(1 + rng() % 4));
+	for (const string &expr : exprs)
+	{
+		Program prog = compilePostfix(parseInfix(expr));
+		if (!encloses(expr, prog)) failures++;
+		optimizeProgram(prog);
+		if (!encloses(expr + " (optimized)", prog)) failures++;
+	}
+
+	//Where sqrt is NaN max(1, sqrt(x)) is 1, the line must not be culled there
+	WorkerPool pool;
+	vector<Function> funcs = { compileFunction("max(1,sqrt(x))") }, line = { compileFunction("1+0*x") };
+	Canvas canvas(400, 200), expected(400, 200);
+	renderPlot(funcs, 0.05, 200, 100, false, pool, canvas);
+	renderPlot(line, 0.05, 200, 100, false, pool, expected);
+	int missing = 0;
+	for (int y = 0; y < 200; y++)
+		for (int x = 0; x < 200; x++) missing += canvas.pixels[y * 400 + x] != expected.pixels[y * 400 + x];
+	if (missing)
+	{
+		printf("FAIL: max(1,sqrt(x)) differs from 1 in %d pixels left of the y axis\n", missing);
+		failures++;
+	}
+
+	printf(failures ? "FAIL: %d enclosures or plots are wrong\n" : "OK: %d expressions enclosed\n", failures ? failures : (int)exprs.size());
+	return failures ? 1 : 0;
+}